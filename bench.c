@@ -0,0 +1,154 @@
+//Author Maxim Popov
+//Microbenchmarks of tile generation, pathfinding and trainer turns, built without ncurses as PokemonBench.
+//They link the same engine library as the game, so they time exactly the code the game runs.
+//Every benchmark reseeds rand() with the same seed, so two builds run exactly the same work and their
+//results, printed as CSV, can be compared line by line.
+//usage: PokemonBench [seed]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "engine.h"
+
+#define BENCH_TILES 300
+#define BENCH_GROW_SEEDS_TILES 1000
+#define BENCH_DIJKSTRA_CALLS 2000
+#define BENCH_TRAINER_TURNS 300000
+#define BENCH_VARIANT_MAX_SIZE 64
+
+int bench_print(const char *benchmark, const char *variant, unsigned int seed, long iterations, uint64_t nanoseconds);
+int bench_tiles(unsigned int seed);
+int bench_grow_seeds(unsigned int seed);
+int bench_dijkstra(unsigned int seed);
+int bench_trainer_turns(unsigned int seed, int trainers);
+
+int main(int argc, char *argv[]) {
+
+    unsigned int seed = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+    for (int direction = 0; direction < 8; direction++) {
+        neighbor_offsets[direction] = direction_y[direction] * TILE_STRIDE + direction_x[direction];
+    }
+    printf("benchmark,variant,seed,iterations,seconds,per_second,us_each\n");
+    bench_tiles(seed);
+    bench_grow_seeds(seed);
+    bench_dijkstra(seed);
+    int trainer_counts[] = {10, 100, 500, 1500};
+    for (int i = 0; i < (int) (sizeof(trainer_counts) / sizeof(trainer_counts[0])); i++) {
+        bench_trainer_turns(seed, trainer_counts[i]);
+    }
+
+    return 0;
+
+}
+
+int bench_print(const char *benchmark, const char *variant, unsigned int seed, long iterations, uint64_t nanoseconds) {
+
+    double seconds = nanoseconds / 1e9;
+    printf("%s,%s,%u,%ld,%.6f,%.1f,%.3f\n", benchmark, variant, seed, iterations, seconds,
+           seconds > 0 ? iterations / seconds : 0.0, iterations > 0 ? nanoseconds / 1e3 / iterations : 0.0);
+    fflush(stdout);
+
+    return 0;
+
+}
+
+int bench_tiles(unsigned int seed) {
+
+    //tiles are spread over the world, since how likely buildings are depends on the distance to its center
+    srand(seed);
+    num_trainers = 10;
+    uint64_t total = 0;
+    for (int i = 0; i < BENCH_TILES; i++) {
+        uint64_t start = timer_now();
+        struct tile tile = create_tile(i * 37 % WORLD_WIDTH_X, i * 91 % WORLD_LENGTH_Y);
+        total += timer_now() - start;
+        destroy_tile(&tile);
+    }
+    bench_print("create_tile", "10 trainers", seed, BENCH_TILES, total);
+
+    return 0;
+
+}
+
+int bench_grow_seeds(unsigned int seed) {
+
+    //seeds are planted the way generate_terrain plants them, but only growing them is timed
+    srand(seed);
+    uint64_t total = 0;
+    for (int i = 0; i < BENCH_GROW_SEEDS_TILES; i++) {
+        struct tile tile = create_empty_tile();
+        init_trainers(&tile.trainers, 0);
+        plant_seeds(&tile, grass, rand() % 5 + 2);
+        plant_seeds(&tile, clearing, rand() % 5 + 2);
+        plant_seeds(&tile, forest, rand() % 5);
+        plant_seeds(&tile, mountain, rand() % 4);
+        plant_seeds(&tile, lake, rand() % 3);
+        uint64_t start = timer_now();
+        grow_seeds(&tile);
+        total += timer_now() - start;
+        destroy_tile(&tile);
+    }
+    bench_print("grow_seeds", "per tile", seed, BENCH_GROW_SEEDS_TILES, total);
+
+    return 0;
+
+}
+
+int bench_dijkstra(unsigned int seed) {
+
+    srand(seed);
+    num_trainers = 10;
+    struct tile tile = create_tile(WORLD_CENTER_X, WORLD_CENTER_Y);
+    place_player_character(&tile);
+    enum character_type cost_classes[] = {RIVAL, HIKER};
+    for (int i = 0; i < 2; i++) {
+        uint64_t start = timer_now();
+        for (int call = 0; call < BENCH_DIJKSTRA_CALLS; call++) {
+            dijkstra(&tile, cost_classes[i]);
+        }
+        bench_print("dijkstra", character_type_strings[cost_classes[i]], seed, BENCH_DIJKSTRA_CALLS, timer_now() - start);
+    }
+    destroy_tile(&tile);
+    free(player_character);
+    player_character = NULL;
+
+    return 0;
+
+}
+
+int bench_trainer_turns(unsigned int seed, int trainers) {
+
+    //the PC rests in place while the tile's trainers take BENCH_TRAINER_TURNS turns; only theirs are counted
+    srand(seed);
+    num_trainers = trainers;
+    struct tile *tile = malloc(sizeof(struct tile));
+    *tile = create_tile(WORLD_CENTER_X, WORLD_CENTER_Y);
+    current_tile_x = WORLD_CENTER_X;
+    current_tile_y = WORLD_CENTER_Y;
+    world[current_tile_y][current_tile_x] = tile;
+    place_player_character(tile);
+    long turns = 0;
+    int *turn;
+    uint64_t start = timer_now();
+    while (turns < BENCH_TRAINER_TURNS && (turn = heap_peek_min(tile->turn_heap))) {
+        if (turn == &player_character->turn) {
+            player_character->turn += MINIMUM_TURN;
+            reschedule(tile->turn_heap, player_character->heap_node);
+        }
+        else {
+            trainer_turn(tile, turn);
+            turns++;
+        }
+    }
+    uint64_t nanoseconds = timer_now() - start;
+    char variant[BENCH_VARIANT_MAX_SIZE];
+    snprintf(variant, sizeof(variant), "%d trainers", tile->trainers.count);
+    bench_print("trainer_turn", variant, seed, turns, nanoseconds);
+    world[current_tile_y][current_tile_x] = NULL;
+    destroy_tile(tile);
+    free(tile);
+    free(player_character);
+    player_character = NULL;
+
+    return 0;
+
+}
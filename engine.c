@@ -0,0 +1,2315 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "engine.h"
+
+//first bytes of a --save file
+#define SNAPSHOT_MAGIC "PKMNSNP2"
+//bytes a snapshot keeps per cell of a tile: terrain id, a move mask per movement class, rival and hiker distances
+#define SNAPSHOT_CELL_BYTES (1 + NUM_MOVEMENT_CLASSES + 2 * sizeof(int))
+
+//Author Maxim Popov
+struct terrain none = {0,'_', 0, 0, 0, 0, "\033[0;30m"};
+struct terrain edge = {1, '%', INT_MAX, INT_MAX, INT_MAX, INT_MAX, "\033[0;37m"};
+struct terrain clearing =
+        {2, '.', 5, 10, 10, 5, "\033[0;33m"};
+struct terrain grass =
+        {3, ',', 10, 15, 15, 5, "\033[0;32m"};
+struct terrain forest = {4, '^', 100, INT_MAX, INT_MAX, 10, "\033[0;32m"};
+struct terrain mountain = {5, '%', 150, INT_MAX, INT_MAX, 10, "\033[0;37m"};
+struct terrain lake = {6, '~', 200, INT_MAX, INT_MAX, INT_MAX, "\033[0;34m"};
+struct terrain path = {7,'#', 0, 5, 5, 5, "\033[0;30m"};
+struct terrain center = {8, 'C', INT_MAX, 5, INT_MAX, INT_MAX, "\033[0;35m"};
+struct terrain mart = {9, 'M', INT_MAX, 5, INT_MAX, INT_MAX, "\033[0;35m"};
+//terrain of each terrain id, to turn the ids in a snapshot back into terrain
+struct terrain *terrains_by_id[NUM_TERRAINS] = {&none, &edge, &clearing, &grass, &forest, &mountain, &lake, &path, &center, &mart};
+
+//fixed size records of a snapshot file; pointers are left out and rebuilt when it is loaded
+struct snapshot_header {
+    char magic[8];
+    int32_t tile_width_x;
+    int32_t tile_length_y;
+    int32_t num_trainers;
+    int32_t num_tiles;
+    int32_t current_tile_x;
+    int32_t current_tile_y;
+    //rand() is reseeded with this when loading
+    uint32_t random_seed;
+    uint32_t policy_random_state;
+    int64_t turns_taken;
+    int64_t pc_turns_taken;
+    int32_t pc_x;
+    int32_t pc_y;
+    int32_t pc_turn;
+    int32_t pc_in_building;
+};
+
+//followed by the tile's terrain ids as bytes, its move masks, its rival and hiker distance tiles,
+//then the x, y, turn, direction, flags and type of each trainer as arrays
+struct snapshot_tile {
+    int32_t x;
+    int32_t y;
+    int32_t north_x;
+    int32_t south_x;
+    int32_t east_y;
+    int32_t west_y;
+    int32_t turn_offset;
+    int32_t suspended_turn;
+    uint32_t random_state;
+    int32_t num_trainers;
+    int32_t has_pc;
+    //the tile's minimap summary, so that loading never reads its terrain
+    int32_t trainers_remaining;
+    int64_t turns_simulated;
+    uint8_t dominant_terrain;
+    uint8_t summary_flags;
+    uint8_t padding[6];
+};
+
+static int32_t comparator_trainer_distance_tile(const void *key, const void *with) {
+    return ((struct point *) key)->distance - ((struct point *) with)->distance;
+}
+
+//turn heap keys are pointers to the turn of the PC or of a trainer
+//ties go to the PC, then to the lower trainer index, so the order never depends on the heap's shape
+static int32_t comparator_character_movement(const void *key, const void *with) {
+    int difference = *((int *) key) - *((int *) with);
+    if (difference != 0 || key == with) {
+        return difference;
+    }
+    if (player_character != NULL && key == &player_character->turn) {
+        return -1;
+    }
+    if (player_character != NULL && with == &player_character->turn) {
+        return 1;
+    }
+    return key < with ? -1 : 1;
+}
+
+static uint64_t hash_snapshot_cells(uint64_t hash, struct tile *tile);
+static int snapshot_put(const void *bytes, size_t size, size_t count, FILE *snapshot);
+static const void *snapshot_take(const unsigned char *snapshot, size_t size, size_t *offset, size_t length);
+static int check_snapshot_tile(const struct snapshot_tile *snapshot_tile, const int *trainer_arrays, unsigned char *taken_cells);
+static int simulate_tile(void *time, int i);
+static inline int dijkstra_kernel(struct tile *tile, enum character_type trainer_type, const int width, const int length);
+
+//movement behavior of each trainer type: adding a behavior means adding an entry here
+int (*trainer_behaviors[])(struct tile *tile, int trainer) = {
+        [RIVAL] = move_rival,
+        [HIKER] = move_hiker,
+        [RANDOM_WALKER] = move_random_walker,
+        [PACER] = move_pacer,
+        [WANDERER] = move_random_walker,
+        [STATIONARY] = move_stationary
+};
+//cheap stand-ins for the turns a trainer missed while its tile was not simulated, indexed like trainer_behaviors
+int (*trainer_catch_ups[])(struct tile *tile, int trainer, int elapsed) = {
+        [RIVAL] = catch_up_rival,
+        [HIKER] = catch_up_hiker,
+        [RANDOM_WALKER] = catch_up_random_walker,
+        [PACER] = catch_up_pacer,
+        [WANDERER] = catch_up_random_walker,
+        [STATIONARY] = catch_up_stationary
+};
+char *character_type_strings[] = {
+        [PLAYER] = "PLAYER",
+        [RIVAL] = "RIVAL",
+        [HIKER] = "HIKER",
+        [RANDOM_WALKER] = "RANDOM WALKER",
+        [PACER] = "PACER",
+        [WANDERER] = "WANDERER",
+        [STATIONARY] = "STATIONARY"
+};
+char character_printable_characters[] = {
+        [PLAYER] = '@',
+        [RIVAL] = 'r',
+        [HIKER] = 'h',
+        [RANDOM_WALKER] = 'n',
+        [PACER] = 'p',
+        [WANDERER] = 'w',
+        [STATIONARY] = 's'
+};
+enum movement_class trainer_movement_classes[] = {
+        [PLAYER] = MOVEMENT_RIVAL,
+        [RIVAL] = MOVEMENT_RIVAL,
+        [HIKER] = MOVEMENT_HIKER,
+        [RANDOM_WALKER] = MOVEMENT_RIVAL,
+        [PACER] = MOVEMENT_RIVAL,
+        [WANDERER] = MOVEMENT_WANDERER,
+        [STATIONARY] = MOVEMENT_RIVAL
+};
+//directions ordered so that direction 7 - d is the opposite of d
+int direction_x[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+int direction_y[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+//CELL offset of each direction, set once the tile size is known
+int neighbor_offsets[8];
+char *character_colors[] = {
+        [PLAYER] = "\033[0;36m",
+        [RIVAL] = "\033[31m",
+        [HIKER] = "\033[31m",
+        [RANDOM_WALKER] = "\033[31m",
+        [PACER] = "\033[31m",
+        [WANDERER] = "\033[31m",
+        [STATIONARY] = "\033[31m"
+};
+
+struct tile *world[WORLD_LENGTH_Y][WORLD_WIDTH_X] = {0};
+//indexed like world; tiles that were never generated have no TILE_SUMMARY_GENERATED flag
+struct tile_summary tile_summaries[WORLD_LENGTH_Y][WORLD_WIDTH_X] = {0};
+//behind TILE_WIDTH_X and TILE_LENGTH_Y
+int tile_width_x = DEFAULT_TILE_WIDTH_X;
+int tile_length_y = DEFAULT_TILE_LENGTH_Y;
+int current_tile_x;
+int current_tile_y;
+struct character *player_character;
+int num_trainers;
+//the policy has its own generator so a replay, which doesn't ask it for keys, draws the same world
+unsigned int policy_random_state;
+long turns_taken = 0;
+long pc_turns_taken = 0;
+//every tile generated so far, which the world simulation ticks when it is on
+struct tile **resident_tiles = NULL;
+int num_resident_tiles = 0;
+int resident_tiles_capacity = 0;
+//the resident tiles handed to the pool for one simulate_world call
+struct tile **simulated_tiles = NULL;
+//NULL unless the world simulation was asked for with --world-threads
+struct pool *world_pool = NULL;
+//totals over every dijkstra call, each of which uses a short lived heap
+heap_stats_t dijkstra_heap_stats;
+#ifdef PHASE_STATS
+struct timer_histogram phase_timers[NUM_PHASES];
+//trainer behaviors are timed per trainer type, on whichever thread runs them
+struct timer_histogram behavior_timers[NUM_CHARACTER_TYPES];
+#endif
+int (*show_combat)(int from_character, int to_character) = NULL;
+
+uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t size) {
+
+    //64 bit FNV-1a
+    const unsigned char *byte = bytes;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ byte[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+
+}
+
+uint64_t state_hash() {
+
+    //everything a replay could get wrong: terrain, who stands where, and when everyone moves next
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < num_resident_tiles; i++) {
+        struct tile *tile = resident_tiles[i];
+        struct trainers *trainers = &tile->trainers;
+        hash = hash_bytes(hash, &tile->x, sizeof(int));
+        hash = hash_bytes(hash, &tile->y, sizeof(int));
+        hash = hash_bytes(hash, &tile->turn_offset, sizeof(int));
+        if (tile->snapshot_cells != NULL) {
+            hash = hash_snapshot_cells(hash, tile);
+        }
+        else {
+            for (int y = 0; y < TILE_LENGTH_Y; y++) {
+                for (int x = 0; x < TILE_WIDTH_X; x++) {
+                    hash = hash_bytes(hash, &tile->tile[CELL(x, y)].terrain.id, sizeof(int));
+                    hash = hash_bytes(hash, &tile->tile[CELL(x, y)].character, sizeof(int));
+                }
+            }
+        }
+        hash = hash_bytes(hash, &trainers->count, sizeof(int));
+        hash = hash_bytes(hash, trainers->x, trainers->count * sizeof(int));
+        hash = hash_bytes(hash, trainers->y, trainers->count * sizeof(int));
+        hash = hash_bytes(hash, trainers->turn, trainers->count * sizeof(int));
+        hash = hash_bytes(hash, trainers->direction, trainers->count * sizeof(int));
+        hash = hash_bytes(hash, trainers->flags, trainers->count * sizeof(int));
+    }
+    hash = hash_bytes(hash, &current_tile_x, sizeof(int));
+    hash = hash_bytes(hash, &current_tile_y, sizeof(int));
+    hash = hash_bytes(hash, &player_character->x, sizeof(int));
+    hash = hash_bytes(hash, &player_character->y, sizeof(int));
+    hash = hash_bytes(hash, &player_character->turn, sizeof(int));
+    hash = hash_bytes(hash, &turns_taken, sizeof(long));
+    return hash;
+
+}
+
+static uint64_t hash_snapshot_cells(uint64_t hash, struct tile *tile) {
+
+    //hashes the cells of a tile that is not unpacked yet the way state_hash hashes them once it is
+    int cells = TILE_WIDTH_X * TILE_LENGTH_Y;
+    int *characters = malloc(cells * sizeof(int));
+    for (int i = 0; i < cells; i++) {
+        characters[i] = NO_CHARACTER;
+    }
+    struct trainers *trainers = &tile->trainers;
+    for (int trainer = 0; trainer < trainers->count; trainer++) {
+        characters[trainers->y[trainer] * TILE_WIDTH_X + trainers->x[trainer]] = trainer;
+    }
+    if (tile->player_character != NULL) {
+        characters[player_character->y * TILE_WIDTH_X + player_character->x] = PC_CHARACTER;
+    }
+    for (int i = 0; i < cells; i++) {
+        int id = tile->snapshot_cells[i] < NUM_TERRAINS ? tile->snapshot_cells[i] : edge.id;
+        hash = hash_bytes(hash, &id, sizeof(int));
+        hash = hash_bytes(hash, &characters[i], sizeof(int));
+    }
+    free(characters);
+    return hash;
+
+}
+
+int trainer_turn(struct tile *tile, int *turn) {
+
+    //heap keys point into trainers->turn so the offset is the trainer's index
+    struct trainers *trainers = &tile->trainers;
+    int trainer = turn - trainers->turn;
+    TIMER_START(start);
+    trainers->turn[trainer] += trainer_behaviors[trainers->type_enum[trainer]](tile, trainer);
+    TIMER_STOP(start, &behavior_timers[trainers->type_enum[trainer]]);
+    reschedule(tile->turn_heap, trainers->heap_node[trainer]);
+
+    return 0;
+
+}
+
+int simulate_world(struct tile *current_tile, int time) {
+
+    //tiles share nothing the trainers touch, so each one is a separate job and needs no locking
+    int num_tiles = 0;
+    for (int i = 0; i < num_resident_tiles; i++) {
+        if (resident_tiles[i] != current_tile) {
+            simulated_tiles[num_tiles++] = resident_tiles[i];
+        }
+    }
+    pool_run(world_pool, num_tiles, simulate_tile, &time);
+
+    return 0;
+
+}
+
+static int simulate_tile(void *time, int i) {
+
+    return advance_tile(simulated_tiles[i], *(int *) time);
+
+}
+
+int advance_tile(struct tile *tile, int time) {
+
+    //runs the tile's trainers until the next one is due after the given game time
+    unpack_tile(tile);
+    int end_turn = time - tile->turn_offset;
+    int *turn;
+    while ((turn = heap_peek_min(tile->turn_heap)) && *turn <= end_turn) {
+        trainer_turn(tile, turn);
+        tile->turns_simulated++;
+    }
+    //resume_tile then has no time left to skip
+    tile->suspended_turn = time;
+
+    return 0;
+
+}
+
+int add_resident_tile(struct tile *tile) {
+
+    if (num_resident_tiles == resident_tiles_capacity) {
+        resident_tiles_capacity = resident_tiles_capacity == 0 ? 16 : resident_tiles_capacity * 2;
+        resident_tiles = realloc(resident_tiles, resident_tiles_capacity * sizeof(struct tile *));
+        simulated_tiles = realloc(simulated_tiles, resident_tiles_capacity * sizeof(struct tile *));
+    }
+    resident_tiles[num_resident_tiles++] = tile;
+
+    return 0;
+
+}
+
+int reschedule(struct heap *turn_heap, heap_node_t *heap_node) {
+
+    //the key has already been advanced to the new turn: re-sift the existing node instead of reallocating it
+    heap_increase_key_no_replace(turn_heap, heap_node);
+
+    return 0;
+
+}
+
+int move_rival(struct tile *tile, int trainer) {
+
+    return move_pursuer(tile, trainer, tile->rival_distance_tile);
+
+}
+
+int move_hiker(struct tile *tile, int trainer) {
+
+    return move_pursuer(tile, trainer, tile->hiker_distance_tile);
+
+}
+
+int move_pursuer(struct tile *tile, int trainer, int *distance_tile) {
+
+    struct trainers *trainers = &tile->trainers;
+    if (trainers->flags[trainer] & TRAINER_DEFEATED) {
+        //no longer paths to PC
+        return MINIMUM_TURN;
+    }
+    //find the legal neighbor closest to the PC
+    int new_x;
+    int new_y;
+    int new_distance = INT_MAX;
+    int cell = CELL(trainers->x[trainer], trainers->y[trainer]);
+    unsigned int moves = trainer_legal_moves(tile, trainer);
+    while (moves != 0) {
+        int direction = __builtin_ctz(moves);
+        moves &= moves - 1;
+        if (distance_tile[cell + neighbor_offsets[direction]] < new_distance) {
+            new_x = trainers->x[trainer] + direction_x[direction];
+            new_y = trainers->y[trainer] + direction_y[direction];
+            new_distance = distance_tile[cell + neighbor_offsets[direction]];
+        }
+    }
+    if (new_distance == INT_MAX) {
+        //no legal point to move to found
+        return MINIMUM_TURN;
+    }
+    move_character(tile, trainers->x[trainer], trainers->y[trainer], new_x, new_y);
+    int cost = terrain_weight(tile->tile[CELL(new_x, new_y)].terrain, trainers->type_enum[trainer]);
+    //the PC may be in a building the trainer can't enter: it battles from where it stands
+    return cost == INT_MAX ? MINIMUM_TURN : cost;
+
+}
+
+int move_random_walker(struct tile *tile, int trainer) {
+
+    //keep going in the set direction until blocked, then pick a new one
+    if (tile->trainers.flags[trainer] & TRAINER_DIRECTION_SET) {
+        int cost = step_trainer(tile, trainer);
+        if (cost != -1) {
+            return cost;
+        }
+    }
+    return step_trainer_random_direction(tile, trainer);
+
+}
+
+int move_pacer(struct tile *tile, int trainer) {
+
+    struct trainers *trainers = &tile->trainers;
+    if (!(trainers->flags[trainer] & TRAINER_DIRECTION_SET)) {
+        //no direction yet
+        return step_trainer_random_direction(tile, trainer);
+    }
+    int cost = step_trainer(tile, trainer);
+    if (cost != -1) {
+        return cost;
+    }
+    //reverse direction
+    trainers->direction[trainer] = opposite_direction(trainers->direction[trainer]);
+    cost = step_trainer(tile, trainer);
+    if (cost != -1) {
+        return cost;
+    }
+    return MINIMUM_TURN;
+
+}
+
+int move_stationary(struct tile *tile, int trainer) {
+
+    //stationary trainers only wait; the parameters are there to fit trainer_behaviors
+    (void) tile;
+    (void) trainer;
+    return MINIMUM_TURN;
+
+}
+
+int catch_up_rival(struct tile *tile, int trainer, int elapsed) {
+
+    return catch_up_pursuer(tile, trainer, elapsed, tile->rival_distance_tile);
+
+}
+
+int catch_up_hiker(struct tile *tile, int trainer, int elapsed) {
+
+    return catch_up_pursuer(tile, trainer, elapsed, tile->hiker_distance_tile);
+
+}
+
+int catch_up_pursuer(struct tile *tile, int trainer, int elapsed, int *distance_tile) {
+
+    //follows the distance tile downhill for as far as the elapsed time pays for
+    //every step gets strictly closer, so this ends within one path's length however much time passed
+    struct trainers *trainers = &tile->trainers;
+    if (trainers->flags[trainer] & TRAINER_DEFEATED) {
+        return 0;
+    }
+    while (elapsed > 0) {
+        int x = trainers->x[trainer];
+        int y = trainers->y[trainer];
+        int new_x = x;
+        int new_y = y;
+        int cell = CELL(x, y);
+        int new_distance = distance_tile[cell];
+        unsigned int moves = trainer_legal_moves(tile, trainer);
+        while (moves != 0) {
+            int direction = __builtin_ctz(moves);
+            moves &= moves - 1;
+            if (distance_tile[cell + neighbor_offsets[direction]] < new_distance) {
+                new_x = x + direction_x[direction];
+                new_y = y + direction_y[direction];
+                new_distance = distance_tile[cell + neighbor_offsets[direction]];
+            }
+        }
+        if (new_distance == distance_tile[cell]) {
+            //arrived, or blocked by another trainer
+            break;
+        }
+        int cost = terrain_weight(tile->tile[CELL(new_x, new_y)].terrain, trainers->type_enum[trainer]);
+        if (cost > elapsed) {
+            break;
+        }
+        move_character(tile, x, y, new_x, new_y);
+        elapsed -= cost;
+    }
+
+    return 0;
+
+}
+
+int catch_up_random_walker(struct tile *tile, int trainer, int elapsed) {
+
+    //a random walk ends up roughly anywhere near its start, so a few real steps are as good as all of them
+    for (int steps = 0; elapsed > 0 && steps < CATCH_UP_RANDOM_STEPS; steps++) {
+        elapsed -= move_random_walker(tile, trainer);
+    }
+
+    return 0;
+
+}
+
+int catch_up_pacer(struct tile *tile, int trainer, int elapsed) {
+
+    //a pacer goes back and forth along one lane: drop the whole round trips and only walk the remainder
+    struct trainers *trainers = &tile->trainers;
+    if (!(trainers->flags[trainer] & TRAINER_DIRECTION_SET)) {
+        return 0;
+    }
+    int direction = trainers->direction[trainer];
+    int lane = pacer_lane_cost(tile, trainer, direction) + pacer_lane_cost(tile, trainer, opposite_direction(direction));
+    if (lane == 0) {
+        return 0;
+    }
+    //one round trip crosses the whole lane there and back
+    elapsed %= 2 * lane;
+    while (elapsed > 0) {
+        elapsed -= move_pacer(tile, trainer);
+    }
+
+    return 0;
+
+}
+
+int pacer_lane_cost(struct tile *tile, int trainer, int direction) {
+
+    //cost of walking from the trainer to the end of its lane in the direction, without moving it
+    struct trainers *trainers = &tile->trainers;
+    enum movement_class movement_class = trainer_movement_classes[trainers->type_enum[trainer]];
+    int x = trainers->x[trainer];
+    int y = trainers->y[trainer];
+    int cost = 0;
+    while (1) {
+        int new_x = x + direction_x[direction];
+        int new_y = y + direction_y[direction];
+        if (!movement_allows(tile, movement_class, x, y, new_x, new_y) || cell_occupied(tile, new_x, new_y)) {
+            return cost;
+        }
+        cost += terrain_weight(tile->tile[CELL(new_x, new_y)].terrain, trainers->type_enum[trainer]);
+        x = new_x;
+        y = new_y;
+    }
+
+}
+
+int catch_up_stationary(struct tile *tile, int trainer, int elapsed) {
+
+    //nothing to catch up on; the parameters are there to fit trainer_catch_ups
+    (void) tile;
+    (void) trainer;
+    (void) elapsed;
+    return 0;
+
+}
+
+unsigned int trainer_legal_moves(struct tile *tile, int trainer) {
+
+    //the cell's mask already covers terrain and other characters: only the PC's cell needs checking here
+    struct trainers *trainers = &tile->trainers;
+    int x = trainers->x[trainer];
+    int y = trainers->y[trainer];
+    enum movement_class movement_class = trainer_movement_classes[trainers->type_enum[trainer]];
+    unsigned int moves = tile->move_masks[movement_class][CELL(x, y)];
+    if (tile->pc_x != -1 && !(trainers->flags[trainer] & TRAINER_DEFEATED)) {
+        int pc_x = tile->pc_x;
+        int pc_y = tile->pc_y;
+        if (abs(pc_x - x) <= 1 && abs(pc_y - y) <= 1
+            && (movement_class == MOVEMENT_RIVAL || movement_class == MOVEMENT_HIKER
+                || movement_allows(tile, movement_class, x, y, pc_x, pc_y))) {
+            //pursuers can always reach the PC's cell: it is where their distance tiles start
+            moves |= 1 << direction_index(pc_x - x, pc_y - y);
+        }
+    }
+    return moves;
+
+}
+
+int step_trainer(struct tile *tile, int trainer) {
+
+    //moves one cell in the trainer's direction and returns the cost, or -1 if that cell can't be entered
+    struct trainers *trainers = &tile->trainers;
+    int direction = trainers->direction[trainer];
+    if (!(trainer_legal_moves(tile, trainer) & (1 << direction))) {
+        return -1;
+    }
+    int new_x = trainers->x[trainer] + direction_x[direction];
+    int new_y = trainers->y[trainer] + direction_y[direction];
+    move_character(tile, trainers->x[trainer], trainers->y[trainer], new_x, new_y);
+    int cost = terrain_weight(tile->tile[CELL(new_x, new_y)].terrain, trainers->type_enum[trainer]);
+    return cost == INT_MAX ? MINIMUM_TURN : cost;
+
+}
+
+int step_trainer_random_direction(struct tile *tile, int trainer) {
+
+    //picks uniformly among the legal directions in one draw
+    unsigned int moves = trainer_legal_moves(tile, trainer);
+    if (moves == 0) {
+        return MINIMUM_TURN;
+    }
+    for (int skip = rand_r(&tile->random_state) % __builtin_popcount(moves); skip > 0; skip--) {
+        moves &= moves - 1;
+    }
+    tile->trainers.direction[trainer] = __builtin_ctz(moves);
+    tile->trainers.flags[trainer] |= TRAINER_DIRECTION_SET;
+    return step_trainer(tile, trainer);
+
+}
+
+int movement_allows(struct tile *tile, enum movement_class movement_class, int x, int y, int new_x, int new_y) {
+
+    //terrain part of a move's legality, which never changes once the tile is generated
+    if (new_x <= 0 || new_x >= TILE_WIDTH_X - 1 || new_y <= 0 || new_y >= TILE_LENGTH_Y - 1) {
+        return 0;
+    }
+    struct terrain terrain = tile->tile[CELL(new_x, new_y)].terrain;
+    if (movement_class == MOVEMENT_HIKER) {
+        return terrain.hiker_weight != INT_MAX;
+    }
+    else if (movement_class == MOVEMENT_WANDERER) {
+        //wanderers never leave the terrain they spawned in
+        return terrain.id == tile->tile[CELL(x, y)].terrain.id && terrain.rival_weight != INT_MAX;
+    }
+    else {
+        return terrain.rival_weight != INT_MAX;
+    }
+
+}
+
+int compute_move_masks(struct tile *tile) {
+
+    //built once terrain is final and before any character is placed
+    for (int movement_class = 0; movement_class < NUM_MOVEMENT_CLASSES; movement_class++) {
+        for (int y = 0; y < TILE_LENGTH_Y; y++) {
+            for (int x = 0; x < TILE_WIDTH_X; x++) {
+                unsigned char mask = 0;
+                for (int direction = 0; direction < 8; direction++) {
+                    int new_x = x + direction_x[direction];
+                    int new_y = y + direction_y[direction];
+                    if (movement_allows(tile, movement_class, x, y, new_x, new_y)
+                        && !cell_occupied(tile, new_x, new_y)) {
+                        mask |= 1 << direction;
+                    }
+                }
+                tile->move_masks[movement_class][CELL(x, y)] = mask;
+            }
+        }
+    }
+
+    return 0;
+
+}
+
+int update_move_masks(struct tile *tile, int x, int y) {
+
+    //(x, y) was just occupied or vacated: fix the bit pointing at it in each neighbor's masks
+    int occupied = cell_occupied(tile, x, y);
+    int cell = CELL(x, y);
+    for (int direction = 0; direction < 8; direction++) {
+        int neighbor_x = x + direction_x[direction];
+        int neighbor_y = y + direction_y[direction];
+        unsigned char bit = 1 << opposite_direction(direction);
+        for (int movement_class = 0; movement_class < NUM_MOVEMENT_CLASSES; movement_class++) {
+            unsigned char *mask = &tile->move_masks[movement_class][cell + neighbor_offsets[direction]];
+            if (!occupied && movement_allows(tile, movement_class, neighbor_x, neighbor_y, x, y)) {
+                *mask |= bit;
+            }
+            else {
+                *mask &= ~bit;
+            }
+        }
+    }
+
+    return 0;
+
+}
+
+int occupy_cell(struct tile *tile, int x, int y, int character) {
+
+    tile->tile[CELL(x, y)].character = character;
+    tile->occupancy[y * OCCUPANCY_WORDS + x / 64] |= (uint64_t) 1 << (x % 64);
+    tile->dirty[y * OCCUPANCY_WORDS + x / 64] |= (uint64_t) 1 << (x % 64);
+    if (character == PC_CHARACTER) {
+        tile->pc_x = x;
+        tile->pc_y = y;
+    }
+    update_move_masks(tile, x, y);
+
+    return 0;
+
+}
+
+int vacate_cell(struct tile *tile, int x, int y) {
+
+    tile->tile[CELL(x, y)].character = NO_CHARACTER;
+    tile->occupancy[y * OCCUPANCY_WORDS + x / 64] &= ~((uint64_t) 1 << (x % 64));
+    tile->dirty[y * OCCUPANCY_WORDS + x / 64] |= (uint64_t) 1 << (x % 64);
+    if (x == tile->pc_x && y == tile->pc_y) {
+        tile->pc_x = -1;
+        tile->pc_y = -1;
+    }
+    update_move_masks(tile, x, y);
+
+    return 0;
+
+}
+
+int cell_occupied(struct tile *tile, int x, int y) {
+
+    return (tile->occupancy[y * OCCUPANCY_WORDS + x / 64] >> (x % 64)) & 1;
+
+}
+
+int nearest_free_cell(struct tile *tile, int *x, int *y) {
+
+    //moves (*x, *y) to the closest unoccupied cell the PC can stand on, searching outwards ring by ring
+    for (int ring = 0; ring < TILE_WIDTH_X || ring < TILE_LENGTH_Y; ring++) {
+        for (int candidate_y = *y - ring; candidate_y <= *y + ring; candidate_y++) {
+            for (int candidate_x = *x - ring; candidate_x <= *x + ring; candidate_x++) {
+                if (candidate_x <= 0 || candidate_x >= TILE_WIDTH_X - 1 || candidate_y <= 0
+                    || candidate_y >= TILE_LENGTH_Y - 1
+                    || (abs(candidate_x - *x) != ring && abs(candidate_y - *y) != ring)) {
+                    continue;
+                }
+                if (!cell_occupied(tile, candidate_x, candidate_y)
+                    && tile->tile[CELL(candidate_x, candidate_y)].terrain.pc_weight != INT_MAX) {
+                    *x = candidate_x;
+                    *y = candidate_y;
+                    return 0;
+                }
+            }
+        }
+    }
+    return 1;
+
+}
+
+int direction_index(int x, int y) {
+
+    for (int direction = 0; direction < 8; direction++) {
+        if (direction_x[direction] == x && direction_y[direction] == y) {
+            return direction;
+        }
+    }
+    return -1;
+
+}
+
+int opposite_direction(int direction) {
+
+    //directions are ordered so that opposite ones mirror each other
+    return 7 - direction;
+
+}
+
+int terrain_weight(struct terrain terrain, enum character_type type) {
+
+    //cost class of each character type
+    if (type == PLAYER) {
+        return terrain.pc_weight;
+    }
+    else if (type == HIKER) {
+        return terrain.hiker_weight;
+    }
+    else {
+        return terrain.rival_weight;
+    }
+
+}
+
+int move_character(struct tile *tile, int x, int y, int new_x, int new_y) {
+
+    //only a collision needs to know who is involved, so the cells are read after the bit test
+    if (cell_occupied(tile, new_x, new_y)) {
+        int from_character = tile->tile[CELL(x, y)].character;
+        int to_character = tile->tile[CELL(new_x, new_y)].character;
+        //pc-trainer combat instigated by either party
+        if (from_character == PC_CHARACTER || to_character == PC_CHARACTER) {
+            if (from_character == PC_CHARACTER && tile->trainers.flags[to_character] & TRAINER_DEFEATED) {
+                //PC should not be allowed to move to a defeated trainer's location (as of assignment 1.05)
+                return 2;
+            }
+            else {
+                combat(tile, from_character, to_character);
+            }
+        }
+        //trainer -> trainer = no move
+        else {
+            //this should never happen because this is checked in turn_based_movement in trainer movement
+            return 1;
+        }
+    }
+    else {
+        int from_character = tile->tile[CELL(x, y)].character;
+        set_character_position(tile, from_character, new_x, new_y);
+        vacate_cell(tile, x, y);
+        occupy_cell(tile, new_x, new_y, from_character);
+    }
+    return 0;
+
+}
+
+int set_character_position(struct tile *tile, int character, int x, int y) {
+
+    if (character == PC_CHARACTER) {
+        player_character->x = x;
+        player_character->y = y;
+    }
+    else {
+        struct trainers *trainers = &tile->trainers;
+        int changes_bucket = trainers->x[character] / BUCKET_SIZE != x / BUCKET_SIZE
+                             || trainers->y[character] / BUCKET_SIZE != y / BUCKET_SIZE;
+        if (changes_bucket) {
+            bucket_remove(tile, character);
+        }
+        trainers->x[character] = x;
+        trainers->y[character] = y;
+        if (changes_bucket) {
+            bucket_insert(tile, character);
+        }
+    }
+
+    return 0;
+
+}
+
+int bucket_insert(struct tile *tile, int trainer) {
+
+    struct trainers *trainers = &tile->trainers;
+    int *head = &tile->bucket_head[trainers->y[trainer] / BUCKET_SIZE * BUCKETS_X + trainers->x[trainer] / BUCKET_SIZE];
+    trainers->bucket_prev[trainer] = -1;
+    trainers->bucket_next[trainer] = *head;
+    if (*head != -1) {
+        trainers->bucket_prev[*head] = trainer;
+    }
+    *head = trainer;
+
+    return 0;
+
+}
+
+int bucket_remove(struct tile *tile, int trainer) {
+
+    struct trainers *trainers = &tile->trainers;
+    int next = trainers->bucket_next[trainer];
+    int prev = trainers->bucket_prev[trainer];
+    if (prev != -1) {
+        trainers->bucket_next[prev] = next;
+    }
+    else {
+        tile->bucket_head[trainers->y[trainer] / BUCKET_SIZE * BUCKETS_X + trainers->x[trainer] / BUCKET_SIZE] = next;
+    }
+    if (next != -1) {
+        trainers->bucket_prev[next] = prev;
+    }
+
+    return 0;
+
+}
+
+int nearest_trainer(struct tile *tile, int x, int y, int undefeated_only) {
+
+    //searches rings of buckets outwards from (x, y) and stops once no closer trainer can exist
+    //distances are in moves, so diagonal steps count as 1
+    struct trainers *trainers = &tile->trainers;
+    int bucket_x = x / BUCKET_SIZE;
+    int bucket_y = y / BUCKET_SIZE;
+    int nearest = -1;
+    int nearest_distance = INT_MAX;
+    for (int ring = 0; ring < BUCKETS_X || ring < BUCKETS_Y; ring++) {
+        //every cell of ring r is at least (r - 1) * BUCKET_SIZE + 1 moves away
+        if (nearest != -1 && (ring - 1) * BUCKET_SIZE + 1 > nearest_distance) {
+            break;
+        }
+        for (int by = bucket_y - ring; by <= bucket_y + ring; by++) {
+            for (int bx = bucket_x - ring; bx <= bucket_x + ring; bx++) {
+                if (by < 0 || by >= BUCKETS_Y || bx < 0 || bx >= BUCKETS_X
+                    || (abs(by - bucket_y) != ring && abs(bx - bucket_x) != ring)) {
+                    continue;
+                }
+                for (int trainer = tile->bucket_head[by * BUCKETS_X + bx]; trainer != -1; trainer = trainers->bucket_next[trainer]) {
+                    if (undefeated_only && trainers->flags[trainer] & TRAINER_DEFEATED) {
+                        continue;
+                    }
+                    int dx = abs(trainers->x[trainer] - x);
+                    int dy = abs(trainers->y[trainer] - y);
+                    int trainer_distance = dx > dy ? dx : dy;
+                    if (trainer_distance < nearest_distance) {
+                        nearest = trainer;
+                        nearest_distance = trainer_distance;
+                    }
+                }
+            }
+        }
+    }
+    return nearest;
+
+}
+
+int combat(struct tile *tile, int from_character, int to_character) {
+
+    defeat_trainer(tile, from_character == PC_CHARACTER ? to_character : from_character);
+    if (show_combat != NULL) {
+        show_combat(from_character, to_character);
+    }
+
+    return 0;
+
+}
+
+int defeat_trainer(struct tile *tile, int trainer) {
+
+    if (!(tile->trainers.flags[trainer] & TRAINER_DEFEATED)) {
+        tile->trainers.flags[trainer] |= TRAINER_DEFEATED;
+        tile_summaries[tile->y][tile->x].trainers_remaining--;
+    }
+
+    return 0;
+
+}
+
+int change_tile(int x, int y) {
+
+    if (x >= 0 && x < WORLD_WIDTH_X && y >= 0 && y < WORLD_LENGTH_Y) {
+        struct tile *old_tile = world[current_tile_y][current_tile_x];
+        int time = player_character->turn + old_tile->turn_offset;
+        int created = 0;
+        if (world[y][x] == NULL) {
+            struct tile *new_tile = (malloc(sizeof(struct tile)));
+            *new_tile = create_tile(x, y);
+            //the tile comes into being now: its trainers' turns start from the current game time,
+            //and there is no earlier time for the world simulation or resume_tile to catch them up on
+            new_tile->turn_offset = time;
+            new_tile->suspended_turn = time;
+            world[y][x] = new_tile;
+            add_resident_tile(new_tile);
+            summarize_tile(new_tile);
+            created = 1;
+        }
+        old_tile->player_character = NULL;
+        heap_remove_node(old_tile->turn_heap, player_character->heap_node);
+        suspend_tile(old_tile, time);
+        current_tile_x = x;
+        current_tile_y = y;
+        struct tile *new_tile = world[current_tile_y][current_tile_x];
+        unpack_tile(new_tile);
+        if (world_pool != NULL && !created) {
+            //the world simulation last ran the tile at the PC's previous turn
+            advance_tile(new_tile, time);
+        }
+        //trainers on the new tile are brought to the PC's time by shifting the tile's offset
+        resume_tile(new_tile, time);
+        new_tile->player_character = player_character;
+        player_character->turn = time - new_tile->turn_offset;
+        heap_insert_node(new_tile->turn_heap, player_character->heap_node);
+        return 0;
+    }
+    else {
+        return 1;
+    }
+
+}
+
+int suspend_tile(struct tile *tile, int time) {
+
+    //the turn heap is left as is: only remember when the tile stopped being simulated
+    tile->suspended_turn = time;
+
+    return 0;
+
+}
+
+int resume_tile(struct tile *tile, int time) {
+
+    //trainers are moved to roughly where the missed time would have taken them, O(trainers) however long it was
+    int elapsed = time - tile->suspended_turn;
+    if (elapsed > 0) {
+        struct trainers *trainers = &tile->trainers;
+        for (int trainer = 0; trainer < trainers->count; trainer++) {
+            trainer_catch_ups[trainers->type_enum[trainer]](tile, trainer, elapsed);
+        }
+    }
+    //their schedule keeps its phase: turns in the heap are relative to turn_offset, so shifting it is O(1)
+    tile->turn_offset += elapsed;
+    tile->suspended_turn = time;
+
+    return 0;
+
+}
+
+struct tile create_tile(int x, int y) {
+
+    TIMER_START(start);
+    struct tile tile = create_empty_tile();
+    tile.x = x;
+    tile.y = y;
+    generate_terrain(&tile);
+    //-1 like the tile fields below: the neighbour lookups are commented out, and generate_paths picks its own gates
+    int north_x = -1;
+    if (y > 0 && world[y - 1][x] != NULL) {
+        //north_x = world[y - 1][x]->south_x;
+    }
+    else {
+        north_x = rand() % (TILE_WIDTH_X - 10) + 5;
+    }
+    int south_x = -1;
+    if (y < WORLD_LENGTH_Y - 1 && world[y + 1][x] != NULL) {
+        //south_x = world[y + 1][x]->north_x;
+    }
+    else {
+        south_x = rand() % (TILE_WIDTH_X - 10) + 5;
+    }
+    int east_y = -1;
+    if (x < WORLD_WIDTH_X - 1 && world[y][x + 1] != NULL) {
+        //east_y = world[y][x + 1]->west_y;
+    }
+    else {
+        east_y = rand() % (TILE_LENGTH_Y - 10) + 5;
+    }
+    int west_y = -1;
+    if (x > 0 && world[y][x - 1] != NULL) {
+        //west_y = world[y][x - 1]->east_y;
+    }
+    else {
+        west_y = rand() % (TILE_LENGTH_Y - 10) + 5;
+    }
+    generate_paths(&tile, north_x, south_x, east_y, west_y);
+    generate_buildings(&tile, x, y);
+    compute_move_masks(&tile);
+    place_trainers(&tile);
+    TIMER_STOP(start, &phase_timers[PHASE_CREATE_TILE]);
+    return tile;
+
+}
+
+struct tile create_empty_tile() {
+
+    struct tile tile;
+    struct point empty_point =
+            {-1, -1,none, none, NO_CHARACTER, INT_MAX, NULL};
+    tile.tile = malloc(TILE_CELLS * sizeof(struct point));
+    for (int i = 0; i < NUM_MOVEMENT_CLASSES; i++) {
+        tile.move_masks[i] = calloc(TILE_CELLS, 1);
+    }
+    tile.occupancy = calloc(TILE_LENGTH_Y * OCCUPANCY_WORDS, sizeof(uint64_t));
+    tile.dirty = calloc(TILE_LENGTH_Y * OCCUPANCY_WORDS, sizeof(uint64_t));
+    tile.bucket_head = malloc(BUCKETS_Y * BUCKETS_X * sizeof(int));
+    tile.rival_distance_tile = malloc(TILE_CELLS * sizeof(int));
+    tile.hiker_distance_tile = malloc(TILE_CELLS * sizeof(int));
+    for (int i = -1; i <= TILE_LENGTH_Y; i++) {
+        for (int j = -1; j <= TILE_WIDTH_X; j++) {
+            tile.tile[CELL(j, i)] = empty_point;
+            tile.tile[CELL(j, i)].x = j;
+            tile.tile[CELL(j, i)].y = i;
+            if (i == -1 || i == TILE_LENGTH_Y || j == -1 || j == TILE_WIDTH_X) {
+                tile.tile[CELL(j, i)].terrain = edge;
+            }
+        }
+    }
+    tile.pc_x = -1;
+    tile.pc_y = -1;
+    tile.player_character = NULL;
+    for (int i = 0; i < BUCKETS_Y; i++) {
+        for (int j = 0; j < BUCKETS_X; j++) {
+            tile.bucket_head[i * BUCKETS_X + j] = -1;
+        }
+    }
+    tile.north_x = -1;
+    tile.south_x = -1;
+    tile.east_y = -1;
+    tile.west_y = -1;
+    tile.turn_heap = malloc(sizeof(struct heap));
+    heap_init(tile.turn_heap, comparator_character_movement, NULL);
+    tile.turn_offset = 0;
+    tile.suspended_turn = 0;
+    for (int i = 0; i < TILE_CELLS; i++) {
+        tile.rival_distance_tile[i] = INT_MAX;
+        tile.hiker_distance_tile[i] = INT_MAX;
+    }
+    tile.random_state = rand();
+    tile.turns_simulated = 0;
+    tile.snapshot_cells = NULL;
+    return tile;
+
+}
+
+int destroy_tile(struct tile *tile) {
+
+    //frees what create_tile allocated, but not the PC; the game keeps every tile, benchmarks throw theirs away
+    free(tile->tile);
+    for (int i = 0; i < NUM_MOVEMENT_CLASSES; i++) {
+        free(tile->move_masks[i]);
+    }
+    free(tile->occupancy);
+    free(tile->dirty);
+    free(tile->bucket_head);
+    free(tile->rival_distance_tile);
+    free(tile->hiker_distance_tile);
+    heap_delete(tile->turn_heap);
+    free(tile->turn_heap);
+    struct trainers *trainers = &tile->trainers;
+    free(trainers->x);
+    free(trainers->y);
+    free(trainers->turn);
+    free(trainers->direction);
+    free(trainers->flags);
+    free(trainers->type_enum);
+    free(trainers->heap_node);
+    free(trainers->bucket_next);
+    free(trainers->bucket_prev);
+
+    return 0;
+
+}
+
+int generate_terrain(struct tile *tile) {
+
+    TIMER_START(start);
+    const int NUM_TALL_GRASS_SEEDS = rand() % 5 + 2;
+    const int NUM_CLEARING_SEEDS = rand() % 5 + 2;
+    const int NUM_FOREST_SEEDS = rand() % 5;
+    const int NUM_MOUNTAIN_SEEDS = rand() % 4;
+    const int NUM_LAKE_SEEDS = rand() % 3;
+    plant_seeds(tile, grass, NUM_TALL_GRASS_SEEDS);
+    plant_seeds(tile, clearing, NUM_CLEARING_SEEDS);
+    plant_seeds(tile, forest, NUM_FOREST_SEEDS);
+    plant_seeds(tile, mountain, NUM_MOUNTAIN_SEEDS);
+    plant_seeds(tile, lake, NUM_LAKE_SEEDS);
+    grow_seeds(tile);
+    place_edge(tile);
+    set_terrain_border_weights(tile);
+
+    TIMER_STOP(start, &phase_timers[PHASE_GENERATE_TERRAIN]);
+    return 0;
+
+}
+
+int plant_seeds(struct tile *tile, struct terrain terrain, int num_seeds) {
+
+    TIMER_START(start);
+    for (int i = 0; i < num_seeds; i++) {
+        int placed = 0;
+        while (placed == 0) {
+            int x = rand() % (TILE_WIDTH_X - 2) + 1;
+            int y = rand() % (TILE_LENGTH_Y - 2) + 1;
+            if (tile->tile[CELL(x, y)].terrain.id == none.id) {
+                tile->tile[CELL(x, y)].terrain = terrain;
+                placed = 1;
+            }
+        }
+    }
+
+    TIMER_STOP(start, &phase_timers[PHASE_PLANT_SEEDS]);
+    return 0;
+
+}
+
+int grow_seeds(struct tile *tile) {
+
+    TIMER_START(start);
+    //queue implementation:
+    //add each (coordinate, terrain) tuple structure to queue
+    //while queue not empty
+    //pop
+    //if does not have terrain
+    //give terrain as specified in tuple
+    //give space weight value for dijkstra (as defined earlier)
+    //add all spaces within 3x and 1y to queue with same terrain
+
+    //loop through non-edge to grow seeds
+    int complete = 0;
+    while (complete == 0) {
+        //if no changes made in a loop then no more loops required
+        complete = 1;
+        //determine what must grow
+        for (int i = 1; i < TILE_LENGTH_Y - 1; i++) {
+            for (int j = 1; j < TILE_WIDTH_X - 1; j++) {
+                int cell = CELL(j, i);
+                if (tile->tile[cell].terrain.id == none.id) {
+                    //loop through nearby area to copy first terrain found
+                    //the outer ring is still none while seeds grow, so it never spreads and needs no bounds check
+                    for (int k = -1; k <=1; k++) {
+                        for (int l = -1; l <= 1; l++) {
+                            struct terrain new_terrain = tile->tile[cell + l * TILE_STRIDE + k].terrain;
+                            if (new_terrain.id != none.id) {
+                                tile->tile[cell].grow_into = new_terrain;
+                            }
+                        }
+                    }
+                    complete = 0;
+                }
+            }
+        }
+        //grow what must grow
+        for (int i = 1; i < TILE_LENGTH_Y - 1; i++) {
+            for (int j = 1; j < TILE_WIDTH_X - 1; j++) {
+                struct terrain new_terrain = tile->tile[CELL(j, i)].grow_into;
+                if (new_terrain.id != none.id) {
+                    tile->tile[CELL(j, i)].terrain = new_terrain;
+                }
+            }
+        }
+    }
+
+    TIMER_STOP(start, &phase_timers[PHASE_GROW_SEEDS]);
+    return 0;
+
+}
+
+int place_edge(struct tile *tile) {
+
+    //places edge (stones with different name and higher weight) on edges
+    for (int i = 0; i < TILE_WIDTH_X; i ++) {
+        tile->tile[CELL(i, 0)].terrain = edge;
+        tile->tile[CELL(i, TILE_LENGTH_Y - 1)].terrain = edge;
+    }
+    for (int i = 0; i < TILE_LENGTH_Y; i ++) {
+        tile->tile[CELL(0, i)].terrain = edge;
+        tile->tile[CELL(TILE_WIDTH_X - 1, i)].terrain = edge;
+    }
+
+    return 0;
+
+}
+
+int set_terrain_border_weights(struct tile *tile) {
+
+    TIMER_START(start);
+    //Sets borders between non-edge terrain types to weight 0
+    for (int i = 1; i < TILE_LENGTH_Y - 1; i++) {
+        for (int j = 1; j < TILE_WIDTH_X - 1; j++) {
+            int cell = CELL(j, i);
+            struct terrain terrain = tile->tile[cell].terrain;
+            //the outer ring is edge by now, which the check below skips anyway
+            for (int direction = 0; direction < 8; direction++) {
+                struct terrain other_terrain = tile->tile[cell + neighbor_offsets[direction]].terrain;
+                if (terrain.id != other_terrain.id && other_terrain.id != edge.id) {
+                    tile->tile[cell].terrain.path_weight = TERRAIN_BORDER_WEIGHT;
+                }
+            }
+        }
+    }
+
+    TIMER_STOP(start, &phase_timers[PHASE_SET_TERRAIN_BORDER_WEIGHTS]);
+    return 0;
+
+}
+
+int generate_paths(struct tile *tile, int north_x, int south_x, int east_y, int west_y) {
+
+    TIMER_START(start);
+    north_x = TILE_WIDTH_X / 2 - 1;
+    south_x = TILE_WIDTH_X / 2 - 1;
+    west_y = TILE_LENGTH_Y / 2;
+    east_y = TILE_LENGTH_Y / 2;
+
+    //used in both paths:
+    int current_x;
+    int current_y;
+    //x = none; n = north; s = south; e = east; w = west
+    char last_move;
+    int moves_since_last_change;
+    const int repetitive_limit = 3;
+
+    //North/South path
+    current_x = north_x;
+    current_y = 0;
+    last_move = 'x';
+    moves_since_last_change = 0;
+    tile->tile[CELL(current_x, current_y)].terrain = path;
+    while (current_y < TILE_LENGTH_Y - 2) {
+        //determine weights
+        int east_weight = INT_MAX;
+        int west_weight = INT_MAX;
+        int south_weight = INT_MAX;
+        if (current_x < TILE_WIDTH_X - 4 && last_move != 'w'
+            && !(moves_since_last_change > repetitive_limit && last_move == 'e')) {
+            east_weight = tile->tile[CELL(current_x + 1, current_y)].terrain.path_weight;
+        }
+        if (current_x > 2 && last_move != 'e' && !(moves_since_last_change > repetitive_limit && last_move == 'w')) {
+            west_weight = tile->tile[CELL(current_x - 1, current_y)].terrain.path_weight;
+        }
+        if (current_y < TILE_LENGTH_Y - 1 && !(moves_since_last_change > repetitive_limit && last_move == 's')) {
+            south_weight = tile->tile[CELL(current_x, current_y + 1)].terrain.path_weight;
+        }
+        //choose the lowest weight
+        if (east_weight < west_weight && east_weight < south_weight) {
+            current_x++;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+            if (last_move == 'e') {
+                moves_since_last_change++;
+            }
+            else {
+                last_move = 'e';
+                moves_since_last_change = 0;
+            }
+        }
+        else if (west_weight < south_weight) {
+            current_x--;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+            if (last_move == 'w') {
+                moves_since_last_change++;
+            }
+            else {
+                last_move = 'w';
+                moves_since_last_change = 0;
+            }
+        }
+        else {
+            current_y++;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+            if (last_move == 's') {
+                moves_since_last_change++;
+            }
+            else {
+                last_move = 's';
+                moves_since_last_change = 0;
+            }
+        }
+    }
+    if (current_x < south_x) {
+        for (int i = current_x; i <= south_x; i++) {
+            current_x = i;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+        }
+    }
+    else if (current_x > south_x) {
+        for (int i = current_x; i >= south_x; i--) {
+            current_x = i;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+        }
+    }
+    tile->tile[CELL(current_x, current_y + 1)].terrain = path;
+
+    //West/East path
+    current_x = 0;
+    current_y = west_y;
+    last_move = 'x';
+    moves_since_last_change = 0;
+    tile->tile[CELL(current_x, current_y)].terrain = path;
+    while (current_x < TILE_WIDTH_X - 2) {
+        //determine weights
+        int north_weight = INT_MAX;
+        int south_weight = INT_MAX;
+        int east_weight = INT_MAX;
+        if (current_y < TILE_LENGTH_Y - 3 && last_move != 'n'
+            && !(moves_since_last_change > repetitive_limit && last_move == 's')) {
+            south_weight = tile->tile[CELL(current_x, current_y + 1)].terrain.path_weight;
+        }
+        if (current_y > 2 && last_move != 's' && !(moves_since_last_change > repetitive_limit && last_move == 'n')) {
+            north_weight = tile->tile[CELL(current_x, current_y - 1)].terrain.path_weight;
+        }
+        if (current_x < TILE_WIDTH_X - 2 && !(moves_since_last_change > repetitive_limit && last_move == 'e')) {
+            east_weight = tile->tile[CELL(current_x + 1, current_y)].terrain.path_weight;
+        }
+        //choose the lowest weight
+        if (north_weight < south_weight && north_weight < east_weight) {
+            current_y--;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+            if (last_move == 'n') {
+                moves_since_last_change++;
+            }
+            else {
+                last_move = 'n';
+                moves_since_last_change = 0;
+            }
+        }
+        else if (south_weight < east_weight) {
+            current_y++;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+            if (last_move == 's') {
+                moves_since_last_change++;
+            }
+            else {
+                last_move = 's';
+                moves_since_last_change = 0;
+            }
+        }
+        else {
+            current_x++;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+            if (last_move == 'e') {
+                moves_since_last_change++;
+            }
+            else {
+                last_move = 'e';
+                moves_since_last_change = 0;
+            }
+        }
+    }
+    if (current_y < east_y) {
+        for (int i = current_y; i <= east_y; i++) {
+            current_y = i;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+        }
+    }
+    else if (current_y > east_y) {
+        for (int i = current_y; i >= east_y; i--) {
+            current_y = i;
+            tile->tile[CELL(current_x, current_y)].terrain = path;
+        }
+    }
+    tile->tile[CELL(current_x + 1, current_y)].terrain = path;
+
+    tile->north_x = north_x;
+    tile->south_x = south_x;
+    tile->west_y = west_y;
+    tile ->east_y = east_y;
+
+    //uncomment below and modify it to match paths across tiles.
+//    //used in both paths:
+//    int current_x;
+//    int current_y;
+//    //x = none; n = north; s = south; e = east; w = west
+//    char last_move;
+//    int moves_since_last_change;
+//    const int repetitive_limit = 3;
+//
+//    //North/South path
+//    current_x = north_x;
+//    current_y = 0;
+//    last_move = 'x';
+//    moves_since_last_change = 0;
+//    tile->tile[current_y][current_x].terrain = terrain_path;
+//    while (current_y < TILE_LENGTH_Y - 2) {
+//        //determine weights
+//        int east_weight = INT_MAX;
+//        int west_weight = INT_MAX;
+//        int south_weight = INT_MAX;
+//        if (current_x < TILE_WIDTH_X - 4 && last_move != 'w'
+//            && !(moves_since_last_change > repetitive_limit && last_move == 'e')) {
+//            east_weight = tile->tile[current_y][current_x + 1].weight;
+//        }
+//        if (current_x > 2 && last_move != 'e' && !(moves_since_last_change > repetitive_limit && last_move == 'w')) {
+//            west_weight = tile->tile[current_y][current_x - 1].weight;
+//        }
+//        if (current_y < TILE_LENGTH_Y - 1 && !(moves_since_last_change > repetitive_limit && last_move == 's')) {
+//            south_weight = tile->tile[current_y + 1][current_x].weight;
+//        }
+//        //choose lowest weight
+//        if (east_weight < west_weight && east_weight < south_weight) {
+//            current_x++;
+//            tile->tile[current_y][current_x].terrain = terrain_path;
+//            if (last_move == 'e') {
+//                moves_since_last_change++;
+//            }
+//            else {
+//                last_move = 'e';
+//                moves_since_last_change = 0;
+//            }
+//        }
+//        else if (west_weight < south_weight) {
+//            current_x--;
+//            tile->tile[current_y][current_x].terrain = terrain_path;
+//            if (last_move == 'w') {
+//                moves_since_last_change++;
+//            }
+//            else {
+//                last_move = 'w';
+//                moves_since_last_change = 0;
+//            }
+//        }
+//        else {
+//            current_y++;
+//            tile->tile[current_y][current_x].terrain = terrain_path;
+//            if (last_move == 's') {
+//                moves_since_last_change++;
+//            }
+//            else {
+//                last_move = 's';
+//                moves_since_last_change = 0;
+//            }
+//        }
+//    }
+//    tile->tile[current_y + 1][current_x].terrain = terrain_path;
+//
+//    //West/East path
+//    current_x = 0;
+//    current_y = west_y;
+//    last_move = 'x';
+//    moves_since_last_change = 0;
+//    tile->tile[current_y][current_x].terrain = terrain_path;
+//    while (current_x < TILE_WIDTH_X - 2) {
+//        //determine weights
+//        int north_weight = INT_MAX;
+//        int south_weight = INT_MAX;
+//        int east_weight = INT_MAX;
+//        if (current_y < TILE_LENGTH_Y - 3 && last_move != 'n'
+//            && !(moves_since_last_change > repetitive_limit && last_move == 's')) {
+//            south_weight = tile->tile[current_y + 1][current_x].weight;
+//        }
+//        if (current_y > 2 && last_move != 's' && !(moves_since_last_change > repetitive_limit && last_move == 'n')) {
+//            north_weight = tile->tile[current_y - 1][current_x].weight;
+//        }
+//        if (current_x < TILE_WIDTH_X - 2 && !(moves_since_last_change > repetitive_limit && last_move == 'e')) {
+//            east_weight = tile->tile[current_y][current_x + 1].weight;
+//        }
+//        //choose lowest weight
+//        if (north_weight < south_weight && north_weight < east_weight) {
+//            current_y--;
+//            tile->tile[current_y][current_x].terrain = terrain_path;
+//            if (last_move == 'n') {
+//                moves_since_last_change++;
+//            }
+//            else {
+//                last_move = 'n';
+//                moves_since_last_change = 0;
+//            }
+//        }
+//        else if (south_weight < east_weight) {
+//            current_y++;
+//            tile->tile[current_y][current_x].terrain = terrain_path;
+//            if (last_move == 's') {
+//                moves_since_last_change++;
+//            }
+//            else {
+//                last_move = 's';
+//                moves_since_last_change = 0;
+//            }
+//        }
+//        else {
+//            current_x++;
+//            tile->tile[current_y][current_x].terrain = terrain_path;
+//            if (last_move == 'e') {
+//                moves_since_last_change++;
+//            }
+//            else {
+//                last_move = 'e';
+//                moves_since_last_change = 0;
+//            }
+//        }
+//    }
+//    tile->tile[current_y][current_x + 1].terrain = terrain_path;
+//
+//    tile->north_x = north_x;
+//    tile->south_x = south_x;
+//    tile->west_y = west_y;
+//    tile ->east_y = east_y;
+
+    TIMER_STOP(start, &phase_timers[PHASE_GENERATE_PATHS]);
+    return 0;
+
+}
+
+int generate_buildings(struct tile *tile, int x, int y) {
+
+    TIMER_START(start);
+    double chance;
+    if (x == WORLD_CENTER_X && y == WORLD_CENTER_Y) {
+        chance = 100;
+    }
+    else {
+        chance = ((-45 * distance(x, y, WORLD_CENTER_X, WORLD_CENTER_Y) / 200) + 50);
+        if (chance < 5) {
+            chance = 5;
+        }
+    }
+    place_building(tile, center, chance);
+    place_building(tile, mart, chance);
+
+    TIMER_STOP(start, &phase_timers[PHASE_GENERATE_BUILDINGS]);
+    return 0;
+
+}
+
+int place_building(struct tile *tile, struct terrain terrain, double chance) {
+
+    if (rand() % 100 < chance) {
+        int x;
+        int y;
+        int valid = 1;
+        while (valid == 1) {
+            x = rand() % (TILE_WIDTH_X - 2) + 1;
+            y = rand() % (TILE_LENGTH_Y - 2) + 1;
+            struct point point = tile->tile[CELL(x, y)];
+            if (!legal_overwrite(point)) {
+                if (tile->tile[CELL(x - 1, y)].terrain.id == path.id
+                    || tile->tile[CELL(x + 1, y)].terrain.id == path.id
+                    || tile->tile[CELL(x, y - 1)].terrain.id == path.id
+                    || tile->tile[CELL(x, y + 1)].terrain.id == path.id) {
+                    valid = 0;
+                }
+            }
+        }
+        tile->tile[CELL(x, y)].terrain = terrain;
+    }
+
+    return 0;
+
+}
+
+int place_player_character(struct tile *tile) {
+
+    struct heap *turn_heap = tile->turn_heap;
+
+    int x;
+    int y;
+    int found = 0;
+    while (found == 0) {
+        x = rand() % (TILE_WIDTH_X - 2) + 1;
+        y = rand() % (TILE_LENGTH_Y - 2) + 1;
+        if (tile->tile[CELL(x, y)].terrain.id == path.id) {
+            found = 1;
+        }
+    }
+    //trainers are placed first and may be standing on the chosen cell
+    nearest_free_cell(tile, &x, &y);
+
+    player_character = malloc(sizeof(struct character));
+    player_character->x = x;
+    player_character->y = y;
+    player_character->type_enum = PLAYER;
+    player_character->type_string = character_type_strings[PLAYER];
+    player_character->printable_character = character_printable_characters[PLAYER];
+    strcpy(player_character->color, character_colors[PLAYER]);
+    player_character->turn = 0;
+    player_character->in_building = 0;
+    player_character->heap_node = heap_insert(turn_heap, &player_character->turn);
+    tile->player_character = player_character;
+    occupy_cell(tile, x, y, PC_CHARACTER);
+    //create distance tiles
+    dijkstra(tile, RIVAL);
+    dijkstra(tile, HIKER);
+
+    return 0;
+
+}
+
+int trainer_can_spawn(struct tile *tile, int x, int y, enum character_type trainer_type) {
+
+    if (tile->player_character == NULL) {
+        //the PC hasn't arrived yet: spawns anywhere the trainer can stand
+        return terrain_weight(tile->tile[CELL(x, y)].terrain, trainer_type) != INT_MAX;
+    }
+    else if (trainer_type == HIKER) {
+        //spawns anywhere hiker can reach PC from
+        return tile->hiker_distance_tile[CELL(x, y)] < INT_MAX;
+    }
+    else {
+        //spawns anywhere rival can reach PC from
+        return tile->rival_distance_tile[CELL(x, y)] < INT_MAX;
+    }
+
+}
+
+int place_trainers(struct tile *tile) {
+
+    TIMER_START(start);
+    //at least one cell the PC can stand on is always left free, so it can enter however crowded the tile is
+    int pc_cells = 0;
+    for (int y = 1; y < TILE_LENGTH_Y - 1; y++) {
+        for (int x = 1; x < TILE_WIDTH_X - 1; x++) {
+            if (tile->tile[CELL(x, y)].terrain.pc_weight != INT_MAX && !cell_occupied(tile, x, y)) {
+                pc_cells++;
+            }
+        }
+    }
+    int num_trainers_copy = num_trainers < pc_cells ? num_trainers : (pc_cells > 0 ? pc_cells - 1 : 0);
+    init_trainers(&tile->trainers, num_trainers_copy);
+
+    int num_rivals = 0;
+    int num_hikers = 0;
+    int num_random_walkers = 0;
+    int num_pacers = 0;
+    int num_wanderers = 0;
+    int num_stationaries = 0;
+    while (num_trainers_copy > 0) {
+        if (num_rivals == 0) {
+            num_rivals++;
+        }
+        else if (num_hikers == 0) {
+            num_hikers++;
+        }
+        else {
+            int random = rand()%10;
+            if (random >= 0 && random <= 2) {
+                num_rivals++;
+            }
+            else if (random >= 3 && random <= 5) {
+                num_hikers++;
+            }
+            else if (random == 6) {
+                num_random_walkers++;
+            }
+            else if (random == 7) {
+                num_pacers++;
+            }
+            else if (random == 8) {
+                num_wanderers++;
+            }
+            else if (random == 9) {
+                num_stationaries++;
+            }
+        }
+        num_trainers_copy--;
+    }
+
+    place_trainer_type(tile, num_rivals, RIVAL);
+    place_trainer_type(tile, num_hikers, HIKER);
+    place_trainer_type(tile, num_random_walkers, RANDOM_WALKER);
+    place_trainer_type(tile, num_pacers, PACER);
+    place_trainer_type(tile, num_wanderers, WANDERER);
+    place_trainer_type(tile, num_stationaries, STATIONARY);
+
+    TIMER_STOP(start, &phase_timers[PHASE_PLACE_TRAINERS]);
+    return 0;
+
+}
+
+int init_trainers(struct trainers *trainers, int capacity) {
+
+    //arrays never grow after the tile is created, so heap keys pointing into turn stay valid
+    trainers->count = 0;
+    trainers->capacity = capacity;
+    trainers->x = malloc(capacity * sizeof(int));
+    trainers->y = malloc(capacity * sizeof(int));
+    trainers->turn = malloc(capacity * sizeof(int));
+    trainers->direction = malloc(capacity * sizeof(int));
+    trainers->flags = malloc(capacity * sizeof(int));
+    trainers->type_enum = malloc(capacity * sizeof(enum character_type));
+    trainers->heap_node = malloc(capacity * sizeof(heap_node_t *));
+    trainers->bucket_next = malloc(capacity * sizeof(int));
+    trainers->bucket_prev = malloc(capacity * sizeof(int));
+
+    return 0;
+
+}
+
+int place_trainer_type(struct tile *tile, int num_trainer, enum character_type trainer_type) {
+
+    struct heap *turn_heap = tile->turn_heap;
+    struct trainers *trainers = &tile->trainers;
+    //every cell the type may spawn on, drawn from without replacement so dense tiles fill in one pass
+    int *candidates = malloc(TILE_CELLS * sizeof(int));
+    int num_candidates = 0;
+    for (int y = 1; y < TILE_LENGTH_Y - 1; y++) {
+        for (int x = 1; x < TILE_WIDTH_X - 1; x++) {
+            if (!cell_occupied(tile, x, y) && trainer_can_spawn(tile, x, y, trainer_type)) {
+                candidates[num_candidates++] = y * TILE_WIDTH_X + x;
+            }
+        }
+    }
+    while (num_trainer > 0 && num_candidates > 0) {
+        int pick = rand() % num_candidates;
+        int x = candidates[pick] % TILE_WIDTH_X;
+        int y = candidates[pick] / TILE_WIDTH_X;
+        candidates[pick] = candidates[--num_candidates];
+        if (trainers->count == trainers->capacity) {
+            free(candidates);
+            return 1;
+        }
+        int trainer = trainers->count++;
+        trainers->x[trainer] = x;
+        trainers->y[trainer] = y;
+        trainers->type_enum[trainer] = trainer_type;
+        trainers->turn[trainer] = 0;
+        trainers->direction[trainer] = 0;
+        trainers->flags[trainer] = 0;
+        trainers->heap_node[trainer] = heap_insert(turn_heap, &trainers->turn[trainer]);
+        occupy_cell(tile, x, y, trainer);
+        bucket_insert(tile, trainer);
+        num_trainer--;
+    }
+    free(candidates);
+
+    return 0;
+
+}
+
+int dijkstra(struct tile *tile, enum character_type trainer_type) {
+
+    TIMER_START(start);
+    int status;
+    //the terminal's 80x21 tile gets its own copy of the kernel with the size folded into every offset and bound
+    if (TILE_WIDTH_X == DEFAULT_TILE_WIDTH_X && TILE_LENGTH_Y == DEFAULT_TILE_LENGTH_Y) {
+        status = dijkstra_kernel(tile, trainer_type, DEFAULT_TILE_WIDTH_X, DEFAULT_TILE_LENGTH_Y);
+    }
+    else {
+        status = dijkstra_kernel(tile, trainer_type, TILE_WIDTH_X, TILE_LENGTH_Y);
+    }
+    TIMER_STOP(start, &phase_timers[trainer_type == HIKER ? PHASE_DIJKSTRA_HIKER : PHASE_DIJKSTRA_RIVAL]);
+    return status;
+
+}
+
+static inline __attribute__((always_inline))
+int dijkstra_kernel(struct tile *tile, enum character_type trainer_type, const int width, const int length) {
+
+    //same layout as CELL, with the size known at compile time in the fast path
+    const int stride = width + 2;
+    const int cells = stride * (length + 2);
+    const int offsets[8] = {-stride - 1, -stride, -stride + 1, -1, 1, stride - 1, stride, stride + 1};
+    struct point *points = tile->tile;
+    int start_x = tile->player_character->x;
+    int start_y =tile->player_character->y;
+
+    //the halo is edge terrain, so it is never queued and keeps INT_MAX distances
+    for (int i = 0; i < cells; i++) {
+        points[i].distance = INT_MAX;
+    }
+    points[(start_y + 1) * stride + start_x + 1].distance = 0;
+
+    struct heap heap;
+    static struct point *point;
+    heap_init(&heap, comparator_trainer_distance_tile, NULL);
+    for (int i = 0; i < cells; i++) {
+        int weight;
+        if (trainer_type == RIVAL) {
+            weight = points[i].terrain.rival_weight;
+        }
+        else {
+            //character_type type_enum == hiker
+            weight = points[i].terrain.hiker_weight;
+        }
+        if (weight != INT_MAX) {
+            points[i].heap_node = heap_insert(&heap, &points[i]);
+        }
+        else {
+            points[i].heap_node = NULL;
+        }
+    }
+    while ((point = heap_remove_min(&heap))) {
+        point->heap_node = NULL;
+        if (point->distance == INT_MAX) {
+            //unreachable, as is everything left in the heap
+            continue;
+        }
+#pragma GCC unroll 8
+        for (int direction = 0; direction < 8; direction++) {
+            struct point *neighbor = point + offsets[direction];
+            //only cells the trainer can enter are in the heap, so the weight below is never INT_MAX
+            if (neighbor->heap_node == NULL) {
+                continue;
+            }
+            int candidate_distance;
+            if (trainer_type == RIVAL) {
+                candidate_distance = point->distance + neighbor->terrain.rival_weight;
+            } else {
+                //character_type type_enum == hiker
+                candidate_distance = point->distance + neighbor->terrain.hiker_weight;
+            }
+            if (candidate_distance < neighbor->distance) {
+                neighbor->distance = candidate_distance;
+                heap_decrease_key_no_replace(&heap, neighbor->heap_node);
+            }
+        }
+    }
+    heap_stats_t heap_stats;
+    if (heap_get_stats(&heap, &heap_stats) == 0) {
+        heap_add_stats(&dijkstra_heap_stats, &heap_stats);
+    }
+    heap_delete(&heap);
+
+    //updates appropriate trainer distance tile for the data to endure through future dijkstra calls
+    int *distance_tile = trainer_type == RIVAL ? tile->rival_distance_tile : tile->hiker_distance_tile;
+    for (int i = 0; i < cells; i++) {
+        distance_tile[i] = points[i].distance;
+    }
+
+    return 0;
+
+}
+
+int legal_overwrite(struct point point) {
+
+    if (point.terrain.id == edge.id
+        || point.terrain.id == path.id
+        || point.terrain.id == center.id
+        || point.terrain.id == mart.id) {
+        return 1;
+    }
+    else {
+        return 0;
+    }
+
+}
+
+double distance(int x1, int y1, int x2, int y2) {
+    double square_difference_x = (x2 - x1) * (x2 - x1);
+    double square_difference_y = (y2 - y1) * (y2 - y1);
+    double sum = square_difference_x + square_difference_y;
+    double value = sqrt(sum);
+    return value;
+}
+
+int summarize_tile(struct tile *tile) {
+
+    //the one pass over the tile the minimap ever makes: buildings, then the natural terrain that covers most of it
+    int terrain_counts[NUM_TERRAINS] = {0};
+    struct tile_summary summary = {clearing.id, TILE_SUMMARY_GENERATED, 0};
+    for (int y = 1; y < TILE_LENGTH_Y - 1; y++) {
+        for (int x = 1; x < TILE_WIDTH_X - 1; x++) {
+            terrain_counts[tile->tile[CELL(x, y)].terrain.id]++;
+        }
+    }
+    if (terrain_counts[center.id] > 0) {
+        summary.flags |= TILE_SUMMARY_CENTER;
+    }
+    if (terrain_counts[mart.id] > 0) {
+        summary.flags |= TILE_SUMMARY_MART;
+    }
+    struct terrain *natural_terrains[] = {&clearing, &grass, &forest, &mountain, &lake};
+    for (int i = 0; i < (int) (sizeof(natural_terrains) / sizeof(natural_terrains[0])); i++) {
+        if (terrain_counts[natural_terrains[i]->id] > terrain_counts[summary.dominant_terrain]) {
+            summary.dominant_terrain = natural_terrains[i]->id;
+        }
+    }
+    for (int trainer = 0; trainer < tile->trainers.count; trainer++) {
+        if (!(tile->trainers.flags[trainer] & TRAINER_DEFEATED)) {
+            summary.trainers_remaining++;
+        }
+    }
+    tile_summaries[tile->y][tile->x] = summary;
+
+    return 0;
+
+}
+
+int tile_footprint(struct tile *tile, struct memory_footprint *footprint) {
+
+    //adds an estimate of the tile's allocations to footprint, from the sizes create_empty_tile and init_trainers ask for
+    //a tile not unpacked from a snapshot yet has no per-cell arrays: its cells are still in the mapped file
+    footprint->objects[MEMORY_TILE_GRIDS]++;
+    footprint->bytes[MEMORY_TILE_GRIDS] += sizeof(struct tile) + sizeof(struct heap);
+    if (tile->tile != NULL) {
+        footprint->bytes[MEMORY_TILE_GRIDS] += TILE_CELLS * (sizeof(struct point) + NUM_MOVEMENT_CLASSES)
+                                               + 2 * TILE_LENGTH_Y * OCCUPANCY_WORDS * sizeof(uint64_t)
+                                               + BUCKETS_Y * BUCKETS_X * sizeof(int);
+        footprint->objects[MEMORY_DISTANCE_MAPS] += 2;
+        footprint->bytes[MEMORY_DISTANCE_MAPS] += 2 * TILE_CELLS * sizeof(int);
+    }
+    struct trainers *trainers = &tile->trainers;
+    footprint->objects[MEMORY_CHARACTERS] += trainers->count;
+    footprint->bytes[MEMORY_CHARACTERS] += (long) trainers->capacity
+                                           * (sizeof(*trainers->x) + sizeof(*trainers->y) + sizeof(*trainers->turn)
+                                              + sizeof(*trainers->direction) + sizeof(*trainers->flags)
+                                              + sizeof(*trainers->type_enum) + sizeof(*trainers->heap_node)
+                                              + sizeof(*trainers->bucket_next) + sizeof(*trainers->bucket_prev));
+    footprint->objects[MEMORY_HEAP_NODES] += tile->turn_heap->size;
+    footprint->bytes[MEMORY_HEAP_NODES] += tile->turn_heap->size * heap_node_size();
+
+    return 0;
+
+}
+
+long footprint_bytes(struct memory_footprint *footprint) {
+
+    long bytes = 0;
+    for (int category = 0; category < NUM_MEMORY_CATEGORIES; category++) {
+        bytes += footprint->bytes[category];
+    }
+    return bytes;
+
+}
+
+int save_snapshot(char *file, uint64_t hash) {
+
+    //tiles not unpacked yet are read from the snapshot they were loaded from, which may be this file:
+    //it is written under another name and only renamed over the old one once complete
+    char *temporary_file = malloc(strlen(file) + sizeof(".tmp"));
+    sprintf(temporary_file, "%s.tmp", file);
+    FILE *snapshot = fopen(temporary_file, "wb");
+    if (snapshot == NULL) {
+        free(temporary_file);
+        return 1;
+    }
+    //every write is checked, but the file is only abandoned once it is closed
+    int status = 0;
+    struct snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.tile_width_x = TILE_WIDTH_X;
+    header.tile_length_y = TILE_LENGTH_Y;
+    header.num_trainers = num_trainers;
+    header.num_tiles = num_resident_tiles;
+    header.current_tile_x = current_tile_x;
+    header.current_tile_y = current_tile_y;
+    //rand() carries on from a seed that depends only on the state, so saving a just loaded game rewrites the same file
+    header.random_seed = (uint32_t) (hash ^ (hash >> 32));
+    header.policy_random_state = policy_random_state;
+    header.turns_taken = turns_taken;
+    header.pc_turns_taken = pc_turns_taken;
+    header.pc_x = player_character->x;
+    header.pc_y = player_character->y;
+    header.pc_turn = player_character->turn;
+    header.pc_in_building = player_character->in_building;
+    status |= snapshot_put(&header, sizeof(header), 1, snapshot);
+
+    unsigned char *terrain_ids = malloc(TILE_WIDTH_X);
+    for (int i = 0; i < num_resident_tiles && status == 0; i++) {
+        struct tile *tile = resident_tiles[i];
+        struct trainers *trainers = &tile->trainers;
+        struct snapshot_tile snapshot_tile;
+        memset(&snapshot_tile, 0, sizeof(snapshot_tile));
+        snapshot_tile.x = tile->x;
+        snapshot_tile.y = tile->y;
+        snapshot_tile.north_x = tile->north_x;
+        snapshot_tile.south_x = tile->south_x;
+        snapshot_tile.east_y = tile->east_y;
+        snapshot_tile.west_y = tile->west_y;
+        snapshot_tile.turn_offset = tile->turn_offset;
+        snapshot_tile.suspended_turn = tile->suspended_turn;
+        snapshot_tile.random_state = tile->random_state;
+        snapshot_tile.num_trainers = trainers->count;
+        snapshot_tile.has_pc = tile->player_character != NULL;
+        snapshot_tile.trainers_remaining = tile_summaries[tile->y][tile->x].trainers_remaining;
+        snapshot_tile.turns_simulated = tile->turns_simulated;
+        snapshot_tile.dominant_terrain = tile_summaries[tile->y][tile->x].dominant_terrain;
+        snapshot_tile.summary_flags = tile_summaries[tile->y][tile->x].flags;
+        status |= snapshot_put(&snapshot_tile, sizeof(snapshot_tile), 1, snapshot);
+        if (tile->snapshot_cells != NULL) {
+            //nothing on the tile has changed since it was loaded
+            status |= snapshot_put(tile->snapshot_cells, SNAPSHOT_CELL_BYTES, TILE_WIDTH_X * TILE_LENGTH_Y, snapshot);
+        }
+        else {
+            for (int y = 0; y < TILE_LENGTH_Y; y++) {
+                for (int x = 0; x < TILE_WIDTH_X; x++) {
+                    terrain_ids[x] = tile->tile[CELL(x, y)].terrain.id;
+                }
+                status |= snapshot_put(terrain_ids, 1, TILE_WIDTH_X, snapshot);
+            }
+            //rows of the per-cell arrays are contiguous between the halo cells
+            for (int movement_class = 0; movement_class < NUM_MOVEMENT_CLASSES; movement_class++) {
+                for (int y = 0; y < TILE_LENGTH_Y; y++) {
+                    status |= snapshot_put(&tile->move_masks[movement_class][CELL(0, y)], 1, TILE_WIDTH_X, snapshot);
+                }
+            }
+            for (int y = 0; y < TILE_LENGTH_Y; y++) {
+                status |= snapshot_put(&tile->rival_distance_tile[CELL(0, y)], sizeof(int), TILE_WIDTH_X, snapshot);
+            }
+            for (int y = 0; y < TILE_LENGTH_Y; y++) {
+                status |= snapshot_put(&tile->hiker_distance_tile[CELL(0, y)], sizeof(int), TILE_WIDTH_X, snapshot);
+            }
+        }
+        status |= snapshot_put(trainers->x, sizeof(int), trainers->count, snapshot);
+        status |= snapshot_put(trainers->y, sizeof(int), trainers->count, snapshot);
+        status |= snapshot_put(trainers->turn, sizeof(int), trainers->count, snapshot);
+        status |= snapshot_put(trainers->direction, sizeof(int), trainers->count, snapshot);
+        status |= snapshot_put(trainers->flags, sizeof(int), trainers->count, snapshot);
+        for (int trainer = 0; trainer < trainers->count; trainer++) {
+            int32_t type = trainers->type_enum[trainer];
+            status |= snapshot_put(&type, sizeof(type), 1, snapshot);
+        }
+    }
+    free(terrain_ids);
+    if (fclose(snapshot) != 0 || status != 0 || rename(temporary_file, file) != 0) {
+        remove(temporary_file);
+        free(temporary_file);
+        return 1;
+    }
+    free(temporary_file);
+
+    return 0;
+
+}
+
+static int snapshot_put(const void *bytes, size_t size, size_t count, FILE *snapshot) {
+
+    //1 if fwrite could not write all of it
+    return fwrite(bytes, size, count, snapshot) != count;
+
+}
+
+static const void *snapshot_take(const unsigned char *snapshot, size_t size, size_t *offset, size_t length) {
+
+    //the next length bytes of the mapped file, or NULL if the file is too short
+    if (length > size - *offset) {
+        return NULL;
+    }
+    const void *bytes = snapshot + *offset;
+    *offset += length;
+    return bytes;
+
+}
+
+int load_snapshot(char *file) {
+
+    //the file is mapped and read in one pass that copies out trainers and everything the world map needs;
+    //the cells of a tile, its grid, heap and buckets are only built when it is first used, by unpack_tile
+    int descriptor = open(file, O_RDONLY);
+    if (descriptor == -1) {
+        return 1;
+    }
+    struct stat file_stat;
+    if (fstat(descriptor, &file_stat) != 0 || file_stat.st_size < (off_t) sizeof(struct snapshot_header)) {
+        close(descriptor);
+        return 1;
+    }
+    size_t size = file_stat.st_size;
+    const unsigned char *snapshot = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (snapshot == MAP_FAILED) {
+        return 1;
+    }
+    size_t offset = 0;
+    struct snapshot_header header;
+    memcpy(&header, snapshot_take(snapshot, size, &offset, sizeof(header)), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+        || header.tile_width_x < MIN_TILE_WIDTH_X || header.tile_length_y < MIN_TILE_LENGTH_Y
+        || (size_t) header.tile_width_x * header.tile_length_y > size
+        || header.num_trainers < 0 || header.num_trainers > MAX_NUM_TRAINERS
+        || header.num_tiles < 0 || header.num_tiles > WORLD_WIDTH_X * WORLD_LENGTH_Y
+        || header.current_tile_x < 0 || header.current_tile_x >= WORLD_WIDTH_X
+        || header.current_tile_y < 0 || header.current_tile_y >= WORLD_LENGTH_Y
+        || header.pc_x < 0 || header.pc_x >= header.tile_width_x
+        || header.pc_y < 0 || header.pc_y >= header.tile_length_y) {
+        munmap((void *) snapshot, size);
+        return 1;
+    }
+    tile_width_x = header.tile_width_x;
+    tile_length_y = header.tile_length_y;
+    for (int direction = 0; direction < 8; direction++) {
+        neighbor_offsets[direction] = direction_y[direction] * TILE_STRIDE + direction_x[direction];
+    }
+    num_trainers = header.num_trainers;
+    current_tile_x = header.current_tile_x;
+    current_tile_y = header.current_tile_y;
+    policy_random_state = header.policy_random_state;
+    turns_taken = header.turns_taken;
+    pc_turns_taken = header.pc_turns_taken;
+
+    player_character = malloc(sizeof(struct character));
+    player_character->x = header.pc_x;
+    player_character->y = header.pc_y;
+    player_character->type_enum = PLAYER;
+    player_character->type_string = character_type_strings[PLAYER];
+    player_character->printable_character = character_printable_characters[PLAYER];
+    strcpy(player_character->color, character_colors[PLAYER]);
+    player_character->turn = header.pc_turn;
+    player_character->in_building = header.pc_in_building;
+
+    int status = 0;
+    size_t cells = (size_t) TILE_WIDTH_X * TILE_LENGTH_Y;
+    unsigned char *taken_cells = calloc(cells, 1);
+    for (int i = 0; i < header.num_tiles && status == 0; i++) {
+        struct snapshot_tile snapshot_tile;
+        const void *bytes = snapshot_take(snapshot, size, &offset, sizeof(snapshot_tile));
+        if (bytes == NULL) {
+            status = 1;
+            break;
+        }
+        memcpy(&snapshot_tile, bytes, sizeof(snapshot_tile));
+        int count = snapshot_tile.num_trainers;
+        const unsigned char *cells_bytes = snapshot_take(snapshot, size, &offset, cells * SNAPSHOT_CELL_BYTES);
+        const int *trainer_arrays = count < 0 ? NULL : snapshot_take(snapshot, size, &offset, 6 * (size_t) count * sizeof(int));
+        if (cells_bytes == NULL || trainer_arrays == NULL
+            || snapshot_tile.x < 0 || snapshot_tile.x >= WORLD_WIDTH_X || snapshot_tile.y < 0
+            || snapshot_tile.y >= WORLD_LENGTH_Y || world[snapshot_tile.y][snapshot_tile.x] != NULL
+            || check_snapshot_tile(&snapshot_tile, trainer_arrays, taken_cells) != 0) {
+            status = 1;
+            break;
+        }
+
+        //only what is needed before the tile is used is built here, see unpack_tile
+        struct tile *tile = calloc(1, sizeof(struct tile));
+        tile->x = snapshot_tile.x;
+        tile->y = snapshot_tile.y;
+        tile->north_x = snapshot_tile.north_x;
+        tile->south_x = snapshot_tile.south_x;
+        tile->east_y = snapshot_tile.east_y;
+        tile->west_y = snapshot_tile.west_y;
+        tile->pc_x = -1;
+        tile->pc_y = -1;
+        tile->turn_heap = malloc(sizeof(struct heap));
+        heap_init(tile->turn_heap, comparator_character_movement, NULL);
+        tile->turn_offset = snapshot_tile.turn_offset;
+        tile->suspended_turn = snapshot_tile.suspended_turn;
+        tile->random_state = snapshot_tile.random_state;
+        tile->turns_simulated = snapshot_tile.turns_simulated;
+        tile->snapshot_cells = cells_bytes;
+        struct trainers *trainers = &tile->trainers;
+        init_trainers(trainers, count);
+        trainers->count = count;
+        memcpy(trainers->x, &trainer_arrays[0], count * sizeof(int));
+        memcpy(trainers->y, &trainer_arrays[count], count * sizeof(int));
+        memcpy(trainers->turn, &trainer_arrays[2 * count], count * sizeof(int));
+        memcpy(trainers->direction, &trainer_arrays[3 * count], count * sizeof(int));
+        memcpy(trainers->flags, &trainer_arrays[4 * count], count * sizeof(int));
+        for (int trainer = 0; trainer < count; trainer++) {
+            trainers->type_enum[trainer] = trainer_arrays[5 * count + trainer];
+        }
+        if (snapshot_tile.has_pc) {
+            tile->player_character = player_character;
+        }
+        world[tile->y][tile->x] = tile;
+        add_resident_tile(tile);
+        struct tile_summary summary = {snapshot_tile.dominant_terrain, snapshot_tile.summary_flags,
+                                       snapshot_tile.trainers_remaining};
+        tile_summaries[tile->y][tile->x] = summary;
+    }
+    free(taken_cells);
+    if (status == 0 && (world[current_tile_y][current_tile_x] == NULL
+                        || world[current_tile_y][current_tile_x]->player_character != player_character)) {
+        status = 1;
+    }
+    if (status != 0) {
+        munmap((void *) snapshot, size);
+        return status;
+    }
+    //the other tiles keep reading their cells from the mapping, which therefore stays for the rest of the game
+    unpack_tile(world[current_tile_y][current_tile_x]);
+    srand(header.random_seed);
+
+    return status;
+
+}
+
+static int check_snapshot_tile(const struct snapshot_tile *snapshot_tile, const int *trainer_arrays, unsigned char *taken_cells) {
+
+    //1 if anything the game indexes with is out of range: gates, positions, trainer types and directions,
+    //the minimap terrain, or two characters on one cell; taken_cells is all 0 before and after
+    int count = snapshot_tile->num_trainers;
+    if (snapshot_tile->north_x < -1 || snapshot_tile->north_x >= TILE_WIDTH_X
+        || snapshot_tile->south_x < -1 || snapshot_tile->south_x >= TILE_WIDTH_X
+        || snapshot_tile->east_y < -1 || snapshot_tile->east_y >= TILE_LENGTH_Y
+        || snapshot_tile->west_y < -1 || snapshot_tile->west_y >= TILE_LENGTH_Y
+        || count > TILE_WIDTH_X * TILE_LENGTH_Y || snapshot_tile->dominant_terrain >= NUM_TERRAINS
+        || (snapshot_tile->has_pc && (snapshot_tile->x != current_tile_x || snapshot_tile->y != current_tile_y))) {
+        return 1;
+    }
+    int status = 0;
+    int checked = 0;
+    for (; checked < count; checked++) {
+        int x = trainer_arrays[checked];
+        int y = trainer_arrays[count + checked];
+        int direction = trainer_arrays[3 * count + checked];
+        int type = trainer_arrays[5 * count + checked];
+        if (x < 0 || x >= TILE_WIDTH_X || y < 0 || y >= TILE_LENGTH_Y || direction < 0 || direction >= 8
+            || type <= PLAYER || type >= NUM_CHARACTER_TYPES || taken_cells[y * TILE_WIDTH_X + x]) {
+            status = 1;
+            break;
+        }
+        taken_cells[y * TILE_WIDTH_X + x] = 1;
+    }
+    if (status == 0 && snapshot_tile->has_pc && taken_cells[player_character->y * TILE_WIDTH_X + player_character->x]) {
+        status = 1;
+    }
+    for (int trainer = 0; trainer < checked; trainer++) {
+        taken_cells[trainer_arrays[count + trainer] * TILE_WIDTH_X + trainer_arrays[trainer]] = 0;
+    }
+    return status;
+
+}
+
+int unpack_tile(struct tile *tile) {
+
+    //builds the per-cell arrays of a tile loaded from a snapshot, then puts its characters on the grid
+    //and into the tile's heap, which orders equal turns the same way every time
+    if (tile->snapshot_cells == NULL) {
+        return 0;
+    }
+    int cells = TILE_WIDTH_X * TILE_LENGTH_Y;
+    const unsigned char *terrain_ids = tile->snapshot_cells;
+    const unsigned char *move_masks = terrain_ids + cells;
+    const unsigned char *distances = move_masks + NUM_MOVEMENT_CLASSES * cells;
+    struct point empty_point =
+            {-1, -1, none, none, NO_CHARACTER, INT_MAX, NULL};
+    tile->tile = malloc(TILE_CELLS * sizeof(struct point));
+    for (int i = -1; i <= TILE_LENGTH_Y; i++) {
+        for (int j = -1; j <= TILE_WIDTH_X; j++) {
+            struct point *point = &tile->tile[CELL(j, i)];
+            *point = empty_point;
+            point->x = j;
+            point->y = i;
+            if (i == -1 || i == TILE_LENGTH_Y || j == -1 || j == TILE_WIDTH_X) {
+                point->terrain = edge;
+            }
+            else {
+                unsigned char id = terrain_ids[i * TILE_WIDTH_X + j];
+                point->terrain = *terrains_by_id[id < NUM_TERRAINS ? id : edge.id];
+            }
+        }
+    }
+    //the masks were saved with every character on the tile in place, so they are copied as they are
+    for (int movement_class = 0; movement_class < NUM_MOVEMENT_CLASSES; movement_class++) {
+        tile->move_masks[movement_class] = calloc(TILE_CELLS, 1);
+        for (int y = 0; y < TILE_LENGTH_Y; y++) {
+            memcpy(&tile->move_masks[movement_class][CELL(0, y)], &move_masks[movement_class * cells + y * TILE_WIDTH_X],
+                   TILE_WIDTH_X);
+        }
+    }
+    tile->rival_distance_tile = malloc(TILE_CELLS * sizeof(int));
+    tile->hiker_distance_tile = malloc(TILE_CELLS * sizeof(int));
+    for (int i = 0; i < TILE_CELLS; i++) {
+        tile->rival_distance_tile[i] = INT_MAX;
+        tile->hiker_distance_tile[i] = INT_MAX;
+    }
+    for (int y = 0; y < TILE_LENGTH_Y; y++) {
+        memcpy(&tile->rival_distance_tile[CELL(0, y)], &distances[y * TILE_WIDTH_X * sizeof(int)],
+               TILE_WIDTH_X * sizeof(int));
+        memcpy(&tile->hiker_distance_tile[CELL(0, y)], &distances[(cells + y * TILE_WIDTH_X) * sizeof(int)],
+               TILE_WIDTH_X * sizeof(int));
+    }
+    tile->occupancy = calloc(TILE_LENGTH_Y * OCCUPANCY_WORDS, sizeof(uint64_t));
+    tile->dirty = calloc(TILE_LENGTH_Y * OCCUPANCY_WORDS, sizeof(uint64_t));
+    tile->bucket_head = malloc(BUCKETS_Y * BUCKETS_X * sizeof(int));
+    for (int i = 0; i < BUCKETS_Y * BUCKETS_X; i++) {
+        tile->bucket_head[i] = -1;
+    }
+    tile->snapshot_cells = NULL;
+
+    //occupy_cell would update the masks, which already have every character in them
+    struct trainers *trainers = &tile->trainers;
+    for (int trainer = 0; trainer < trainers->count; trainer++) {
+        int x = trainers->x[trainer];
+        int y = trainers->y[trainer];
+        tile->tile[CELL(x, y)].character = trainer;
+        tile->occupancy[y * OCCUPANCY_WORDS + x / 64] |= (uint64_t) 1 << (x % 64);
+        tile->dirty[y * OCCUPANCY_WORDS + x / 64] |= (uint64_t) 1 << (x % 64);
+        trainers->heap_node[trainer] = heap_insert(tile->turn_heap, &trainers->turn[trainer]);
+        bucket_insert(tile, trainer);
+    }
+    if (tile->player_character != NULL) {
+        int x = player_character->x;
+        int y = player_character->y;
+        tile->tile[CELL(x, y)].character = PC_CHARACTER;
+        tile->occupancy[y * OCCUPANCY_WORDS + x / 64] |= (uint64_t) 1 << (x % 64);
+        tile->dirty[y * OCCUPANCY_WORDS + x / 64] |= (uint64_t) 1 << (x % 64);
+        tile->pc_x = x;
+        tile->pc_y = y;
+        player_character->heap_node = heap_insert(tile->turn_heap, &player_character->turn);
+    }
+
+    return 0;
+
+}
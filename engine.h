@@ -0,0 +1,318 @@
+#ifndef POKEMON_ENGINE_H
+#define POKEMON_ENGINE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "heap.h"
+#include "pool.h"
+#include "timer.h"
+
+//Author Maxim Popov
+//The world of the game without its terminal: tile generation, pathfinding, trainer turns and snapshots.
+//The game links it to draw the world and move the PC through it, the benchmarks to time it.
+
+//the terminal fits 80x21 tiles; headless games may choose any size with --tile-size
+#define DEFAULT_TILE_WIDTH_X 80
+#define DEFAULT_TILE_LENGTH_Y 21
+//smallest tile the path and building generators can work in
+#define MIN_TILE_WIDTH_X 16
+#define MIN_TILE_LENGTH_Y 12
+//tile dimensions are set once at startup, like ncurses' COLS and LINES
+#define TILE_WIDTH_X tile_width_x
+#define TILE_LENGTH_Y tile_length_y
+//per-cell arrays keep a one cell halo around the tile so a neighbor of any cell is always in bounds
+#define TILE_STRIDE (TILE_WIDTH_X + 2)
+#define TILE_CELLS (TILE_STRIDE * (TILE_LENGTH_Y + 2))
+//index of (x, y) into the per-cell arrays of a tile, with x and y from -1 to the tile's width and length
+#define CELL(x, y) (((y) + 1) * TILE_STRIDE + (x) + 1)
+#define WORLD_WIDTH_X 399
+#define WORLD_LENGTH_Y 399
+#define WORLD_CENTER_X 199
+#define WORLD_CENTER_Y 199
+#define TERRAIN_BORDER_WEIGHT 1
+#define MINIMUM_TURN 5
+//most steps a random walker takes to catch up with time that passed without the PC
+#define CATCH_UP_RANDOM_STEPS 32
+//tiles that can't fit this many get as many as their free cells allow, see place_trainers
+#define MAX_NUM_TRAINERS 100000
+//64 bit words per row of a tile's occupancy bitmap
+#define OCCUPANCY_WORDS ((TILE_WIDTH_X + 63) / 64)
+//trainers are indexed by BUCKET_SIZE x BUCKET_SIZE squares of the tile for proximity queries
+#define BUCKET_SIZE 8
+#define BUCKETS_X ((TILE_WIDTH_X + BUCKET_SIZE - 1) / BUCKET_SIZE)
+#define BUCKETS_Y ((TILE_LENGTH_Y + BUCKET_SIZE - 1) / BUCKET_SIZE)
+#define NUM_TERRAINS 10
+
+enum character_type {
+    PLAYER,
+    RIVAL,
+    HIKER,
+    RANDOM_WALKER,
+    PACER,
+    WANDERER,
+    STATIONARY,
+    NUM_CHARACTER_TYPES
+};
+
+struct terrain {
+    //id is for comparison
+    int id;
+    char printable_character;
+    int path_weight;
+    int pc_weight;
+    int rival_weight;
+    int hiker_weight;
+    char color[10];
+};
+
+extern struct terrain none, edge, clearing, grass, forest, mountain, lake, path, center, mart;
+//terrain of each terrain id, to turn the ids in a snapshot back into terrain
+extern struct terrain *terrains_by_id[NUM_TERRAINS];
+
+//the PC; trainers are stored per tile in struct trainers
+struct character {
+    int x;
+    int y;
+    enum character_type type_enum;
+    char *type_string;
+    char printable_character;
+    char color[10];
+    int turn;
+    int in_building;
+    //stable handle into the turn heap of the tile the character is on
+    heap_node_t *heap_node;
+};
+
+#define TRAINER_DIRECTION_SET 1
+#define TRAINER_DEFEATED 2
+
+//struct-of-arrays storage for the trainers of one tile: a trainer is its index into every array
+struct trainers {
+    int count;
+    int capacity;
+    int *x;
+    int *y;
+    //turn heap keys point into this array
+    int *turn;
+    //index into direction_x and direction_y
+    int *direction;
+    int *flags;
+    enum character_type *type_enum;
+    heap_node_t **heap_node;
+    //doubly linked lists of the trainers in each spatial bucket
+    int *bucket_next;
+    int *bucket_prev;
+};
+
+//values of point.character that are not trainer indices
+#define NO_CHARACTER -1
+#define PC_CHARACTER -2
+
+struct point {
+    int x;
+    int y;
+    struct terrain terrain;
+    //for looped non-queue plant_seeds growth
+    struct terrain grow_into;
+    //index into the tile's trainers, NO_CHARACTER or PC_CHARACTER
+    int character;
+    int distance;
+    heap_node_t *heap_node;
+};
+
+//terrain rules a trainer moves by, each with its own legal move masks
+enum movement_class {
+    MOVEMENT_RIVAL,
+    MOVEMENT_HIKER,
+    MOVEMENT_WANDERER,
+    NUM_MOVEMENT_CLASSES
+};
+
+struct tile {
+    //per-cell arrays are TILE_CELLS long and indexed by CELL(x, y)
+    //halo cells are edge terrain with INT_MAX distances, no character and no move masks
+    struct point *tile;
+    //bit d is set if a trainer of the class can step in direction d from the cell right now
+    unsigned char *move_masks[NUM_MOVEMENT_CLASSES];
+    //bit x % 64 of word x / 64 in row y is set if any character stands on (x, y)
+    uint64_t *occupancy;
+    //laid out like occupancy: cells whose character changed since the map was last drawn
+    uint64_t *dirty;
+    //where the PC stands on this tile, or -1 if it isn't here
+    int pc_x;
+    int pc_y;
+    //first trainer in each spatial bucket, or -1
+    int *bucket_head;
+    int x;
+    int y;
+    int north_x;
+    int south_x;
+    int east_y;
+    int west_y;
+    struct character *player_character;
+    struct trainers trainers;
+    //owned by the tile and kept for the whole game so the schedule survives tile switches
+    struct heap *turn_heap;
+    //turns in turn_heap are local to the tile: game time = turn + turn_offset
+    int turn_offset;
+    //game time at which the PC last left the tile, or up to which the world simulation last ran it
+    int suspended_turn;
+    //distances to where the PC is, or last was, on this tile
+    int *rival_distance_tile;
+    int *hiker_distance_tile;
+    //trainer movement draws from the tile's own generator so tiles can be simulated on any thread
+    unsigned int random_state;
+    long turns_simulated;
+    //cells of a tile loaded from a snapshot, in the mapped file, until unpack_tile builds the per-cell arrays from them
+    //the first time the tile is used; the per-cell arrays are NULL until then, and this is NULL afterwards
+    const unsigned char *snapshot_cells;
+};
+
+#define TILE_SUMMARY_GENERATED 1
+#define TILE_SUMMARY_CENTER 2
+#define TILE_SUMMARY_MART 4
+
+//what the minimap knows about a tile, taken when the tile is generated and kept up to date as it changes
+//so that drawing any part of the world never reads a tile itself
+struct tile_summary {
+    //terrain id covering most of the tile
+    unsigned char dominant_terrain;
+    unsigned char flags;
+    int trainers_remaining;
+};
+
+//an estimate of what the game holds in memory, by kind of allocation, worked out from the sizes the allocations
+//are made with rather than counted at them: malloc's own overhead and a mapped snapshot are left out
+enum memory_category {
+    MEMORY_TILE_GRIDS,
+    MEMORY_DISTANCE_MAPS,
+    MEMORY_CHARACTERS,
+    MEMORY_HEAP_NODES,
+    MEMORY_WORLD_TABLES,
+    NUM_MEMORY_CATEGORIES
+};
+
+struct memory_footprint {
+    long objects[NUM_MEMORY_CATEGORIES];
+    long bytes[NUM_MEMORY_CATEGORIES];
+};
+
+//hot paths timed in PHASE_STATS builds and reported on exit with --stats
+enum phase {
+    PHASE_CREATE_TILE,
+    PHASE_GENERATE_TERRAIN,
+    PHASE_PLANT_SEEDS,
+    PHASE_GROW_SEEDS,
+    PHASE_SET_TERRAIN_BORDER_WEIGHTS,
+    PHASE_GENERATE_PATHS,
+    PHASE_GENERATE_BUILDINGS,
+    PHASE_PLACE_TRAINERS,
+    PHASE_DIJKSTRA_RIVAL,
+    PHASE_DIJKSTRA_HIKER,
+    PHASE_DRAW_TILE_TERRAIN,
+    PHASE_SHOW_TILE,
+    NUM_PHASES
+};
+
+uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t size);
+uint64_t state_hash();
+int save_snapshot(char *file, uint64_t hash);
+int load_snapshot(char *file);
+int unpack_tile(struct tile *tile);
+int trainer_turn(struct tile *tile, int *turn);
+int reschedule(struct heap *turn_heap, heap_node_t *heap_node);
+int simulate_world(struct tile *current_tile, int time);
+int advance_tile(struct tile *tile, int time);
+int add_resident_tile(struct tile *tile);
+int move_rival(struct tile *tile, int trainer);
+int move_hiker(struct tile *tile, int trainer);
+int move_pursuer(struct tile *tile, int trainer, int *distance_tile);
+int move_random_walker(struct tile *tile, int trainer);
+int move_pacer(struct tile *tile, int trainer);
+int move_stationary(struct tile *tile, int trainer);
+int catch_up_rival(struct tile *tile, int trainer, int elapsed);
+int catch_up_hiker(struct tile *tile, int trainer, int elapsed);
+int catch_up_pursuer(struct tile *tile, int trainer, int elapsed, int *distance_tile);
+int catch_up_random_walker(struct tile *tile, int trainer, int elapsed);
+int catch_up_pacer(struct tile *tile, int trainer, int elapsed);
+int catch_up_stationary(struct tile *tile, int trainer, int elapsed);
+int pacer_lane_cost(struct tile *tile, int trainer, int direction);
+unsigned int trainer_legal_moves(struct tile *tile, int trainer);
+int step_trainer(struct tile *tile, int trainer);
+int step_trainer_random_direction(struct tile *tile, int trainer);
+int movement_allows(struct tile *tile, enum movement_class movement_class, int x, int y, int new_x, int new_y);
+int compute_move_masks(struct tile *tile);
+int update_move_masks(struct tile *tile, int x, int y);
+int occupy_cell(struct tile *tile, int x, int y, int character);
+int vacate_cell(struct tile *tile, int x, int y);
+int cell_occupied(struct tile *tile, int x, int y);
+int nearest_free_cell(struct tile *tile, int *x, int *y);
+int direction_index(int x, int y);
+int opposite_direction(int direction);
+int terrain_weight(struct terrain terrain, enum character_type type);
+int move_character(struct tile *tile, int x, int y, int new_x, int new_y);
+int set_character_position(struct tile *tile, int character, int x, int y);
+int bucket_insert(struct tile *tile, int trainer);
+int bucket_remove(struct tile *tile, int trainer);
+int nearest_trainer(struct tile *tile, int x, int y, int undefeated_only);
+int combat(struct tile *tile, int from_character, int to_character);
+int defeat_trainer(struct tile *tile, int trainer);
+int change_tile(int x, int y);
+int suspend_tile(struct tile *tile, int time);
+int resume_tile(struct tile *tile, int time);
+struct tile create_tile(int x, int y);
+struct tile create_empty_tile();
+int destroy_tile(struct tile *tile);
+int generate_terrain(struct tile *tile);
+int plant_seeds(struct tile *tile, struct terrain terrain, int num_seeds);
+int grow_seeds(struct tile *tile);
+int place_edge(struct tile *tile);
+int set_terrain_border_weights(struct tile *tile);
+int generate_paths(struct tile *tile, int north_x, int south_x, int east_y, int west_y);
+int generate_buildings(struct tile *tile, int x, int y);
+int place_building(struct tile *tile, struct terrain terrain, double chance);
+int place_player_character(struct tile *tile);
+int place_trainers(struct tile *tile);
+int init_trainers(struct trainers *trainers, int capacity);
+int place_trainer_type(struct tile *tile, int num_trainer, enum character_type trainer_type);
+int trainer_can_spawn(struct tile *tile, int x, int y, enum character_type trainer_type);
+int dijkstra(struct tile *tile, enum character_type trainer_type);
+int legal_overwrite(struct point point);
+double distance(int x1, int y1, int x2, int y2);
+int summarize_tile(struct tile *tile);
+int tile_footprint(struct tile *tile, struct memory_footprint *footprint);
+long footprint_bytes(struct memory_footprint *footprint);
+
+extern int (*trainer_behaviors[])(struct tile *tile, int trainer);
+extern int (*trainer_catch_ups[])(struct tile *tile, int trainer, int elapsed);
+extern char *character_type_strings[];
+extern char character_printable_characters[];
+extern enum movement_class trainer_movement_classes[];
+extern int direction_x[8];
+extern int direction_y[8];
+extern int neighbor_offsets[8];
+extern char *character_colors[];
+extern struct tile *world[WORLD_LENGTH_Y][WORLD_WIDTH_X];
+extern struct tile_summary tile_summaries[WORLD_LENGTH_Y][WORLD_WIDTH_X];
+extern int tile_width_x;
+extern int tile_length_y;
+extern int current_tile_x;
+extern int current_tile_y;
+extern struct character *player_character;
+extern int num_trainers;
+extern unsigned int policy_random_state;
+extern long turns_taken;
+extern long pc_turns_taken;
+extern struct tile **resident_tiles;
+extern int num_resident_tiles;
+extern int resident_tiles_capacity;
+extern struct pool *world_pool;
+extern heap_stats_t dijkstra_heap_stats;
+#ifdef PHASE_STATS
+extern struct timer_histogram phase_timers[NUM_PHASES];
+extern struct timer_histogram behavior_timers[NUM_CHARACTER_TYPES];
+#endif
+//how the game shows a fight between the PC and a trainer, after combat has settled it; NULL shows nothing
+extern int (*show_combat)(int from_character, int to_character);
+
+#endif //POKEMON_ENGINE_H
@@ -16,6 +16,12 @@ struct heap_node {
     uint32_t mark;
 };
 
+#ifdef HEAP_STATS
+# define heap_stat(h, field, n) ((h)->stats.field += (n))
+#else
+# define heap_stat(h, field, n) ((void) 0)
+#endif
+
 #define swap(a, b) ({    \
   typeof (a) _tmp = (a); \
   (a) = (b);             \
@@ -100,6 +106,9 @@ void heap_init(heap_t *h,
     h->size = 0;
     h->compare = compare;
     h->datum_delete = datum_delete;
+#ifdef HEAP_STATS
+    memset(&h->stats, 0, sizeof (h->stats));
+#endif
 }
 
 void heap_node_delete(heap_t *h, heap_node_t *hn)
@@ -131,26 +140,48 @@ void heap_delete(heap_t *h)
     h->datum_delete = NULL;
 }
 
-heap_node_t *heap_insert(heap_t *h, void *v)
+static heap_node_t *heap_link_root(heap_t *h, heap_node_t *n)
 {
-    heap_node_t *n;
-
-    assert((n = calloc(1, sizeof (*n))));
-    n->datum = v;
-
     if (h->min) {
         insert_heap_node_in_list(n, h->min);
     } else {
         n->next = n->prev = n;
     }
-    if (!h->min || (h->compare(v, h->min->datum) < 0)) {
+    if (!h->min || (h->compare(n->datum, h->min->datum) < 0)) {
         h->min = n;
     }
     h->size++;
+#ifdef HEAP_STATS
+    if (h->size > h->stats.peak_size) {
+        h->stats.peak_size = h->size;
+    }
+#endif
 
     return n;
 }
 
+heap_node_t *heap_insert(heap_t *h, void *v)
+{
+    heap_node_t *n;
+
+    n = calloc(1, sizeof (*n));
+    assert(n);
+    n->datum = v;
+
+    return heap_insert_node(h, n);
+}
+
+heap_node_t *heap_insert_node(heap_t *h, heap_node_t *n)
+{
+    /* Links a node that was previously detached with heap_remove_node *
+     * (or allocated by heap_insert) back into the root list, so a    *
+     * caller can keep the same handle across any number of reinserts. */
+
+    heap_stat(h, inserts, 1);
+
+    return heap_link_root(h, n);
+}
+
 void *heap_peek_min(heap_t *h)
 {
     return h->min ? h->min->datum : NULL;
@@ -158,6 +189,9 @@ void *heap_peek_min(heap_t *h)
 
 static void heap_link(heap_t *h, heap_node_t *node, heap_node_t *root)
 {
+    /* h is kept so every structural helper takes the heap first */
+    (void) h;
+
     /*  remove_heap_node_from_list(node);*/
     if (root->child) {
         insert_heap_node_in_list(node, root->child);
@@ -180,10 +214,13 @@ static void heap_consolidate(heap_t *h)
 
     memset(a, 0, sizeof (a));
 
+    heap_stat(h, consolidations, 1);
+
     h->min->prev->next = NULL;
 
     for (x = n = h->min; n; x = n) {
         n = n->next;
+        heap_stat(h, consolidate_nodes_walked, 1);
 
         while (a[x->degree]) {
             y = a[x->degree];
@@ -219,6 +256,7 @@ void *heap_remove_min(heap_t *h)
     v = NULL;
 
     if (h->min) {
+        heap_stat(h, removes, 1);
         v = h->min->datum;
         if (h->size == 1) {
             free(h->min);
@@ -326,6 +364,8 @@ int heap_decrease_key_no_replace(heap_t *h, heap_node_t *n)
 
     heap_node_t *p;
 
+    heap_stat(h, decrease_keys, 1);
+
     p = n->parent;
 
     if (p && (h->compare(n->datum, p->datum) < 0)) {
@@ -339,6 +379,117 @@ int heap_decrease_key_no_replace(heap_t *h, heap_node_t *n)
     return 0;
 }
 
+static heap_node_t *heap_unlink_node(heap_t *h, heap_node_t *n)
+{
+    heap_node_t *c, *p;
+
+    if ((p = n->parent)) {
+        heap_cut(h, n, p);
+        heap_cascading_cut(h, p);
+    }
+
+    if (h->size == 1) {
+        h->min = NULL;
+    } else {
+        if ((c = n->child)) {
+            for (; c->parent; c = c->next) {
+                c->parent = NULL;
+            }
+        }
+
+        splice_heap_node_lists(n, n->child);
+
+        remove_heap_node_from_list(n);
+        if (h->min == n) {
+            h->min = n->next;
+            heap_consolidate(h);
+        }
+    }
+
+    h->size--;
+
+    n->next = n->prev = n;
+    n->parent = n->child = NULL;
+    n->degree = 0;
+    n->mark = 0;
+
+    return n;
+}
+
+heap_node_t *heap_remove_node(heap_t *h, heap_node_t *n)
+{
+    /* Unlinks n from the heap without freeing it.  The node keeps its *
+     * datum and can be handed back to heap_insert_node on this or any *
+     * other heap with the same comparator.                            */
+
+    heap_stat(h, removes, 1);
+
+    return heap_unlink_node(h, n);
+}
+
+int heap_increase_key_no_replace(heap_t *h, heap_node_t *n)
+{
+    /* Same contract as heap_decrease_key_no_replace, but for keys that *
+     * have grown.  The node is popped and pushed back in place, so no  *
+     * memory is freed or allocated and the handle stays valid.         */
+
+    heap_stat(h, increase_keys, 1);
+
+    heap_link_root(h, heap_unlink_node(h, n));
+
+    return 0;
+}
+
+int heap_get_stats(heap_t *h, heap_stats_t *stats)
+{
+#ifdef HEAP_STATS
+    *stats = h->stats;
+
+    return 0;
+#else
+    (void) h;
+    memset(stats, 0, sizeof (*stats));
+
+    return 1;
+#endif
+}
+
+size_t heap_node_size(void)
+{
+    return sizeof (heap_node_t);
+}
+
+void heap_add_stats(heap_stats_t *total, const heap_stats_t *stats)
+{
+    total->inserts += stats->inserts;
+    total->removes += stats->removes;
+    total->decrease_keys += stats->decrease_keys;
+    total->increase_keys += stats->increase_keys;
+    total->consolidations += stats->consolidations;
+    total->consolidate_nodes_walked += stats->consolidate_nodes_walked;
+    if (stats->peak_size > total->peak_size) {
+        total->peak_size = stats->peak_size;
+    }
+}
+
+void heap_print_stats(FILE *f, const char *name, const heap_stats_t *stats)
+{
+    fprintf(f, "%s: inserts %llu, removes %llu, decrease keys %llu, "
+            "increase keys %llu, consolidations %llu "
+            "(%llu nodes walked, %.1f per pass), peak size %u\n",
+            name,
+            (unsigned long long) stats->inserts,
+            (unsigned long long) stats->removes,
+            (unsigned long long) stats->decrease_keys,
+            (unsigned long long) stats->increase_keys,
+            (unsigned long long) stats->consolidations,
+            (unsigned long long) stats->consolidate_nodes_walked,
+            (stats->consolidations ?
+             (double) stats->consolidate_nodes_walked / stats->consolidations :
+             0.0),
+            stats->peak_size);
+}
+
 #ifdef TESTING
 
 int32_t compare(const void *key, const void *with)
@@ -355,6 +506,82 @@ char *print_int(const void *v)
   return out;
 }
 
+int check_order(heap_t *h, heap_node_t **drained)
+{
+  /* Takes every node out with heap_remove_node, checking that keys *
+   * come out in order, then puts the same nodes back.              */
+  int i, size;
+
+  size = h->size;
+  for (i = 0; i < size; i++) {
+    drained[i] = h->min;
+    assert(heap_remove_node(h, drained[i]) == drained[i]);
+    assert(!i || compare(drained[i - 1]->datum, drained[i]->datum) <= 0);
+  }
+  assert(!h->min && !h->size);
+  for (i = 0; i < size; i++) {
+    heap_insert_node(h, drained[i]);
+  }
+
+  return size;
+}
+
+int test_node_operations(int n)
+{
+  heap_t h, h2;
+  int *values;
+  heap_node_t **nodes, **drained, *removed, *min;
+  int i;
+
+  values = calloc(n, sizeof (*values));
+  assert(values);
+  nodes = calloc(n, sizeof (*nodes));
+  assert(nodes);
+  drained = calloc(n, sizeof (*drained));
+  assert(drained);
+
+  heap_init(&h, compare, NULL);
+  heap_init(&h2, compare, NULL);
+  for (i = 0; i < n; i++) {
+    values[i] = i;
+    nodes[i] = heap_insert(&h, &values[i]);
+  }
+  /* Consolidation builds the trees, so some nodes have children */
+  heap_remove_min(&h);
+
+  removed = NULL;
+  for (i = 1; i < n && !removed; i++) {
+    if (nodes[i]->child && nodes[i] != h.min) {
+      removed = nodes[i];
+    }
+  }
+  assert(removed);
+  assert(heap_remove_node(&h, removed) == removed);
+  assert(!removed->child && !removed->parent);
+  assert(check_order(&h, drained) == n - 2);
+
+  min = h.min;
+  *(int *) min->datum += 2 * n;
+  heap_increase_key_no_replace(&h, min);
+  assert(h.min != min);
+  assert(check_order(&h, drained) == n - 2);
+  assert(drained[n - 3] == min);
+
+  heap_insert_node(&h2, removed);
+  heap_insert_node(&h2, heap_remove_node(&h, h.min));
+  assert(check_order(&h, drained) == n - 3);
+  assert(check_order(&h2, drained) == 2);
+  assert(heap_peek_min(&h2) == drained[0]->datum);
+
+  heap_delete(&h);
+  heap_delete(&h2);
+  free(drained);
+  free(nodes);
+  free(values);
+
+  return 0;
+}
+
 int main(int argc, char *argv[])
 {
   heap_t h;
@@ -370,13 +597,16 @@ int main(int argc, char *argv[])
     n = 20;
   }
 
-  assert((keys = calloc(n, sizeof (*keys))));
-  assert((a = calloc(n, sizeof (*a))));
+  keys = calloc(n, sizeof (*keys));
+  assert(keys);
+  a = calloc(n, sizeof (*a));
+  assert(a);
 
   heap_init(&h, compare, free);
 
   for (i = 0; i < n; i++) {
-    assert((keys[i] = malloc(sizeof (*keys[i]))));
+    keys[i] = malloc(sizeof (*keys[i]));
+    assert(keys[i]);
     *keys[i] = i;
     a[i] = heap_insert(&h, keys[i]);
   }
@@ -385,7 +615,8 @@ int main(int argc, char *argv[])
   printf("------------------------------------\n");
 
   heap_remove_min(&h);
-  assert((keys[0] = malloc(sizeof (*keys[0]))));
+  keys[0] = malloc(sizeof (*keys[0]));
+  assert(keys[0]);
   *keys[0] = 0;
   a[0] = heap_insert(&h, keys[0]);
   for (i = 0; i < 100 * n; i++) {
@@ -400,6 +631,12 @@ int main(int argc, char *argv[])
 
   free(keys);
 
+  /* Needs a tree below the roots that is not under the min */
+  if (n >= 8) {
+    test_node_operations(n);
+    printf("node operations: ok\n");
+  }
+
   return 0;
 }
 
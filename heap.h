@@ -6,16 +6,31 @@ extern "C" {
 # endif
 
 # include <stdint.h>
+# include <stdio.h>
 
 //Authored by Professor Jeremy Sheaffer
 struct heap_node;
 typedef struct heap_node heap_node_t;
 
+/* Operation counters, only maintained when built with HEAP_STATS. */
+typedef struct heap_stats {
+    uint64_t inserts;
+    uint64_t removes;
+    uint64_t decrease_keys;
+    uint64_t increase_keys;
+    uint64_t consolidations;
+    uint64_t consolidate_nodes_walked;
+    uint32_t peak_size;
+} heap_stats_t;
+
 typedef struct heap {
     heap_node_t *min;
     uint32_t size;
     int32_t (*compare)(const void *key, const void *with);
     void (*datum_delete)(void *);
+# ifdef HEAP_STATS
+    heap_stats_t stats;
+# endif
 } heap_t;
 
 void heap_init(heap_t *h,
@@ -23,11 +38,19 @@ void heap_init(heap_t *h,
                void (*datum_delete)(void *));
 void heap_delete(heap_t *h);
 heap_node_t *heap_insert(heap_t *h, void *v);
+heap_node_t *heap_insert_node(heap_t *h, heap_node_t *n);
+heap_node_t *heap_remove_node(heap_t *h, heap_node_t *n);
 void *heap_peek_min(heap_t *h);
 void *heap_remove_min(heap_t *h);
 int heap_combine(heap_t *h, heap_t *h1, heap_t *h2);
 int heap_decrease_key(heap_t *h, heap_node_t *n, void *v);
 int heap_decrease_key_no_replace(heap_t *h, heap_node_t *n);
+int heap_increase_key_no_replace(heap_t *h, heap_node_t *n);
+int heap_get_stats(heap_t *h, heap_stats_t *stats);
+/* Bytes of one node, for callers accounting for the memory their heaps hold. */
+size_t heap_node_size(void);
+void heap_add_stats(heap_stats_t *total, const heap_stats_t *stats);
+void heap_print_stats(FILE *f, const char *name, const heap_stats_t *stats);
 
 # ifdef __cplusplus
 }
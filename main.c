@@ -2,165 +2,268 @@
 #include <time.h>
 #include <limits.h>
 #include <string.h>
-#include <math.h>
 #include <getopt.h>
-#include <ncurses.h>
-#include "heap.h"
+#include <signal.h>
+#include "screen.h"
+#include "engine.h"
 
 #define SCREEN_HEIGHT 24
-#define TILE_WIDTH_X 80
-#define TILE_LENGTH_Y 21
-#define WORLD_WIDTH_X 399
-#define WORLD_LENGTH_Y 399
-#define WORLD_CENTER_X 199
-#define WORLD_CENTER_Y 199
+//trainers on one page of the trainer list, below its message line
+#define TRAINER_LIST_ROWS (SCREEN_HEIGHT - 1)
+//tiles of the world shown by the minimap, one character each, between its message and status lines
+#define MINIMAP_ROWS (SCREEN_HEIGHT - 2)
+#define MINIMAP_COLUMNS DEFAULT_TILE_WIDTH_X
 #define COMMAND_MAX_SIZE 256
-#define TERRAIN_BORDER_WEIGHT 1
-#define MINIMUM_TURN 5
-//77 = minimum number of paths in tile - 1 for PC so all trainers can be placed
-#define MAX_NUM_TRAINERS 77
+#define HEADLESS_DEFAULT_TURNS 100000
+//where a memory report asked for with SIGUSR1 goes while the screen is in use
+#define MEMORY_REPORT_FILE "pokemon-memory.txt"
 
 //Author Maxim Popov
-enum character_type {
-    PLAYER,
-    RIVAL,
-    HIKER,
-    RANDOM_WALKER,
-    PACER,
-    WANDERER,
-    STATIONARY
-};
-
-struct terrain {
-    //id is for comparison
-    int id;
-    char printable_character;
-    int path_weight;
-    int pc_weight;
-    int rival_weight;
-    int hiker_weight;
-    char color[10];
-};
-
-struct terrain none = {0,'_', 0, 0, 0, 0, "\033[0;30m"};
-struct terrain edge = {1, '%', INT_MAX, INT_MAX, INT_MAX, INT_MAX, "\033[0;37m"};
-struct terrain clearing =
-        {2, '.', 5, 10, 10, 5, "\033[0;33m"};
-struct terrain grass =
-        {3, ',', 10, 15, 15, 5, "\033[0;32m"};
-struct terrain forest = {4, '^', 100, INT_MAX, INT_MAX, 10, "\033[0;32m"};
-struct terrain mountain = {5, '%', 150, INT_MAX, INT_MAX, 10, "\033[0;37m"};
-struct terrain lake = {6, '~', 200, INT_MAX, INT_MAX, INT_MAX, "\033[0;34m"};
-struct terrain path = {7,'#', 0, 5, 5, 5, "\033[0;30m"};
-struct terrain center = {8, 'C', INT_MAX, 5, INT_MAX, INT_MAX, "\033[0;35m"};
-struct terrain mart = {9, 'M', INT_MAX, 5, INT_MAX, INT_MAX, "\033[0;35m"};
-
-struct character {
-    int x;
-    int y;
-    enum character_type type_enum;
-    char *type_string;
-    char printable_character;
-    char color[10];
-    int turn;
-    int direction_set;
-    int x_direction;
-    int y_direction;
-    int in_building;
-    int defeated;
-};
-
-struct point {
-    int x;
-    int y;
-    struct terrain terrain;
-    //for looped non-queue plant_seeds growth
-    struct terrain grow_into;
-    struct character *character;
-    int distance;
-    heap_node_t *heap_node;
-};
-
-struct tile {
-    struct point tile[TILE_LENGTH_Y][TILE_WIDTH_X];
-    int x;
-    int y;
-    int north_x;
-    int south_x;
-    int east_y;
-    int west_y;
-    struct character *player_character;
-    struct heap *turn_heap;
-};
-
-int rival_distance_tile[TILE_LENGTH_Y][TILE_WIDTH_X];
-int hiker_distance_tile [TILE_LENGTH_Y][TILE_WIDTH_X];
-
-static int32_t comparator_trainer_distance_tile(const void *key, const void *with) {
-    return ((struct point *) key)->distance - ((struct point *) with)->distance;
-}
-
-static int32_t comparator_character_movement(const void *key, const void *with) {
-    return ((struct character *) key)->turn - ((struct character *) with)->turn;
+//trainer list entries are the squared distance to the PC in the high 32 bits and the trainer in the low ones
+static int comparator_trainer_list(const void *key, const void *with) {
+    uint64_t key_entry = *((uint64_t *) key);
+    uint64_t with_entry = *((uint64_t *) with);
+    return (key_entry > with_entry) - (key_entry < with_entry);
 }
 
 int print_usage();
 int initialize_terminal();
+int read_key();
+int replay_key();
+int quit_key();
+int script_key();
+int read_script_line();
+int sleep_milliseconds(long milliseconds);
+int load_replay(char *file, unsigned int *seed, int *numtrainers, int *world_threads);
+int policy_key();
+int print_headless_summary(unsigned int seed, struct timespec *start_time);
 int turn_based_movement();
 int player_turn();
-int move_character(int x, int y, int new_x, int new_y);
-int combat(struct character *from_character, struct character *to_character);
 int enter_center();
 int enter_mart();
 int interaction(struct heap *turn_heap);
-int change_tile(int x, int y);
-struct tile create_tile(int x, int y);
-struct tile create_empty_tile();
-int generate_terrain(struct tile *tile);
-int plant_seeds(struct tile *tile, struct terrain terrain, int num_seeds);
-int grow_seeds(struct tile *tile);
-int place_edge(struct tile *tile);
-int set_terrain_border_weights(struct tile *tile);
-int generate_paths(struct tile *tile, int north_x, int south_x, int east_y, int west_y);
-int generate_buildings(struct tile *tile, int x, int y);
-int place_building(struct tile *tile, struct terrain terrain, double chance);
-int place_player_character(struct tile *tile);
-int place_trainers(struct tile *tile);
-int place_trainer_type(struct tile *tile, int num_trainer, enum character_type trainer_type, char character);
-int dijkstra(struct tile *tile, enum character_type trainer_type);
-int legal_overwrite(struct point point);
-double distance(int x1, int y1, int x2, int y2);
+int show_combat_screen(int from_character, int to_character);
 int print_tile_terrain(struct tile *tile);
+int draw_tile_terrain(struct tile *tile);
+screen_cell_t tile_cell(struct tile *tile, int x, int y);
+int show_tile(struct tile *tile, const char *message);
+int show_trainer_list(struct tile *tile, uint64_t *trainer_list, int count, int position, const char *message);
+screen_cell_t summary_cell(int x, int y);
+int show_minimap(int center_x, int center_y, const char *message);
+int key_direction(int key);
 int reset_color();
 int print_tile_trainer_distances(struct tile *tile);
 int print_tile_trainer_distances_printer(struct tile *tile);
-
-struct tile *world[WORLD_LENGTH_Y][WORLD_WIDTH_X] = {0};
-int current_tile_x;
-int current_tile_y;
-struct character *player_character;
-int num_trainers;
+int print_heap_stats();
+int print_phase_stats();
+int print_memory_report(FILE *f);
+void request_memory_report(int signal_number);
+int answer_memory_report_request();
+
+//how the PC picks its keys when running headless
+enum policy {
+    POLICY_RANDOM,
+    POLICY_SEEK
+};
+enum policy policy = POLICY_RANDOM;
+//--journal records every key read into journal; --replay reads them back from replay_keys instead
+char *journal_file = NULL;
+char *replay_file = NULL;
+FILE *journal = NULL;
+int *replay_keys = NULL;
+long num_replay_keys = 0;
+long next_replay_key = 0;
+uint64_t replay_hash;
+int replay_has_hash = 0;
+//--input reads keys from input_script, a file or a pipe, a line at a time as the game asks for them
+char *input_file = NULL;
+FILE *input_script = NULL;
+long input_lines_read = 0;
+long input_keys_read = 0;
+//keys of the script line being played, input_repeats more times after this one
+int *input_keys = NULL;
+int input_keys_capacity = 0;
+int num_input_keys = 0;
+int next_input_key = 0;
+long input_repeats = 0;
+//milliseconds the script waits before each of its keys
+long input_delay = 0;
+//the game quits once turns_taken reaches max_turns, unless max_turns is negative
+long max_turns = -1;
+//turns a --load snapshot had already taken; --turns, the journal and the turn rate count from there
+long loaded_turns = 0;
+//--save writes the game to save_file when it ends; --load starts from load_file instead of a new world
+char *save_file = NULL;
+char *load_file = NULL;
+//what the map draws for each terrain id and character type, color included, set by initialize_terminal
+screen_cell_t terrain_cells[NUM_TERRAINS];
+screen_cell_t character_cells[NUM_CHARACTER_TYPES];
+//the tile whose map show_tile last drew and the screen_clear_count it drew it at
+struct tile *drawn_tile = NULL;
+int drawn_clear_count = -1;
+//time spent drawing and writing out the map, for the --screen-output report
+double show_tile_seconds = 0;
+long show_tile_calls = 0;
+#ifdef PHASE_STATS
+char *phase_names[] = {
+        [PHASE_CREATE_TILE] = "create_tile",
+        [PHASE_GENERATE_TERRAIN] = "generate_terrain",
+        [PHASE_PLANT_SEEDS] = "plant_seeds",
+        [PHASE_GROW_SEEDS] = "grow_seeds",
+        [PHASE_SET_TERRAIN_BORDER_WEIGHTS] = "set_terrain_border_weights",
+        [PHASE_GENERATE_PATHS] = "generate_paths",
+        [PHASE_GENERATE_BUILDINGS] = "generate_buildings",
+        [PHASE_PLACE_TRAINERS] = "place_trainers",
+        [PHASE_DIJKSTRA_RIVAL] = "dijkstra rival",
+        [PHASE_DIJKSTRA_HIKER] = "dijkstra hiker",
+        [PHASE_DRAW_TILE_TERRAIN] = "draw_tile_terrain",
+        [PHASE_SHOW_TILE] = "show_tile"
+};
+#endif
+int print_stats = 0;
+char *memory_category_names[] = {
+        [MEMORY_TILE_GRIDS] = "tile grids",
+        [MEMORY_DISTANCE_MAPS] = "distance maps",
+        [MEMORY_CHARACTERS] = "characters",
+        [MEMORY_HEAP_NODES] = "heap nodes",
+        [MEMORY_WORLD_TABLES] = "world tables"
+};
+//--memory prints the memory report on exit; SIGUSR1 asks for one, see answer_memory_report_request
+int print_memory = 0;
+volatile sig_atomic_t memory_report_requested = 0;
 
 int main(int argc, char *argv[]) {
 
     //get arguments
     int opt = 0;
     int numtrainers = 10;
+    int world_threads = 0;
+    unsigned int seed = time(NULL);
     static struct option long_options[] = {
             {"numtrainers", required_argument,0,'t' },
+            {"headless", no_argument, 0, 'H' },
+            {"turns", required_argument, 0, 'n' },
+            {"policy", required_argument, 0, 'p' },
+            {"seed", required_argument, 0, 's' },
+            {"world-threads", required_argument, 0, 'w' },
+            {"tile-size", required_argument, 0, 'S' },
+            {"journal", required_argument, 0, 'j' },
+            {"replay", required_argument, 0, 'r' },
+            {"save", required_argument, 0, 'o' },
+            {"load", required_argument, 0, 'l' },
+            {"screen", required_argument, 0, 'd' },
+            {"screen-output", required_argument, 0, 'O' },
+            {"input", required_argument, 0, 'i' },
+            {"stats", no_argument, 0, 'T' },
+            {"memory", no_argument, 0, 'M' },
             {0,0,0,0   }
     };
     int long_index =0;
-    while ((opt = getopt_long(argc, argv,"t:", long_options, &long_index )) != -1) {
+    while ((opt = getopt_long(argc, argv,"t:Hn:p:s:w:S:j:r:o:l:d:O:i:TM", long_options, &long_index )) != -1) {
         switch (opt) {
             case 't' : numtrainers = atoi(optarg);
                 break;
+            case 'H' : screen_headless = 1;
+                break;
+            case 'n' : max_turns = atol(optarg);
+                break;
+            case 'p' :
+                if (strcmp(optarg, "random") == 0) {
+                    policy = POLICY_RANDOM;
+                }
+                else if (strcmp(optarg, "seek") == 0) {
+                    policy = POLICY_SEEK;
+                }
+                else {
+                    print_usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 's' : seed = strtoul(optarg, NULL, 10);
+                break;
+            case 'w' : world_threads = atoi(optarg);
+                break;
+            case 'S' :
+                if (sscanf(optarg, "%dx%d", &tile_width_x, &tile_length_y) != 2) {
+                    print_usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'j' : journal_file = optarg;
+                break;
+            case 'r' : replay_file = optarg;
+                break;
+            case 'o' : save_file = optarg;
+                break;
+            case 'l' : load_file = optarg;
+                break;
+            case 'd' :
+                if (strcmp(optarg, "ncurses") == 0) {
+                    screen_backend = SCREEN_BACKEND_NCURSES;
+                }
+                else if (strcmp(optarg, "ansi") == 0) {
+                    screen_backend = SCREEN_BACKEND_ANSI;
+                }
+                else {
+                    print_usage();
+                    exit(EXIT_FAILURE);
+                }
+                //asking for a screen is what turns one on in a HEADLESS build
+                screen_headless = 0;
+                break;
+            case 'O' : screen_output = optarg;
+                break;
+            case 'i' : input_file = optarg;
+                break;
+            case 'T' : print_stats = 1;
+                break;
+            case 'M' : print_memory = 1;
+                break;
             default: print_usage();
                 exit(EXIT_FAILURE);
         }
     }
+    if (replay_file != NULL) {
+        //the journal decides everything that could make the replay play out differently
+        if (load_replay(replay_file, &seed, &numtrainers, &world_threads) != 0) {
+            fprintf(stderr, "Could not read the journal %s\n", replay_file);
+            exit(EXIT_FAILURE);
+        }
+        screen_headless = 1;
+    }
+    if (input_file != NULL) {
+        if (replay_file != NULL) {
+            fprintf(stderr, "A --replay plays the keys of its journal, so it can't take --input as well\n");
+            exit(EXIT_FAILURE);
+        }
+        if (strcmp(input_file, "-") == 0 && !screen_headless) {
+            fprintf(stderr, "Only --headless games can read --input from standard input, which the screen reads keys from\n");
+            exit(EXIT_FAILURE);
+        }
+        input_script = strcmp(input_file, "-") == 0 ? stdin : fopen(input_file, "r");
+        if (input_script == NULL) {
+            fprintf(stderr, "Could not read the input script %s\n", input_file);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (!screen_interactive() && max_turns < 0 && input_script == NULL) {
+        //a headless game has nobody to press Q; a script quits when it runs out
+        max_turns = HEADLESS_DEFAULT_TURNS;
+    }
 
     //check argument legality
+    if (TILE_WIDTH_X < MIN_TILE_WIDTH_X || TILE_LENGTH_Y < MIN_TILE_LENGTH_Y) {
+        fprintf(stderr, "Tiles must be at least %dx%d\n", MIN_TILE_WIDTH_X, MIN_TILE_LENGTH_Y);
+        exit(EXIT_FAILURE);
+    }
+    for (int direction = 0; direction < 8; direction++) {
+        neighbor_offsets[direction] = direction_y[direction] * TILE_STRIDE + direction_x[direction];
+    }
+    if (!screen_headless && (TILE_WIDTH_X != DEFAULT_TILE_WIDTH_X || TILE_LENGTH_Y != DEFAULT_TILE_LENGTH_Y)) {
+        fprintf(stderr, "Only --headless games can change the tile size from %dx%d\n",
+                DEFAULT_TILE_WIDTH_X, DEFAULT_TILE_LENGTH_Y);
+        exit(EXIT_FAILURE);
+    }
     if (numtrainers < 0) {
         numtrainers = 0;
     }
@@ -170,25 +273,177 @@ int main(int argc, char *argv[]) {
     num_trainers = numtrainers;
 
     //run program
-    srand(time(NULL));
-    initialize_terminal();
-    struct tile home_tile = create_tile(WORLD_CENTER_X, WORLD_CENTER_Y);
-    current_tile_x = WORLD_CENTER_X;
-    current_tile_y = WORLD_CENTER_Y;
-    world[WORLD_CENTER_Y][WORLD_CENTER_X] = &home_tile;
-    place_player_character(world[current_tile_y][current_tile_x]);
+    srand(seed);
+    policy_random_state = seed;
+    if (journal_file != NULL) {
+        journal = fopen(journal_file, "w");
+        if (journal == NULL) {
+            fprintf(stderr, "Could not write the journal %s\n", journal_file);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(journal, "seed %u\nnumtrainers %d\ntile-size %dx%d\nworld-threads %d\n",
+                seed, num_trainers, TILE_WIDTH_X, TILE_LENGTH_Y, world_threads);
+        if (load_file != NULL) {
+            fprintf(journal, "load %s\n", load_file);
+        }
+    }
+    struct pool pool;
+    if (world_threads > 0) {
+        if (pool_init(&pool, world_threads) != 0) {
+            fprintf(stderr, "Could not start %d world simulation threads\n", world_threads);
+            exit(EXIT_FAILURE);
+        }
+        world_pool = &pool;
+    }
+    if (initialize_terminal() != 0) {
+        fprintf(stderr, "Could not start the %s screen\n", screen_backend == SCREEN_BACKEND_ANSI ? "ansi" : "ncurses");
+        exit(EXIT_FAILURE);
+    }
+    struct sigaction memory_report_action;
+    memset(&memory_report_action, 0, sizeof(memory_report_action));
+    memory_report_action.sa_handler = request_memory_report;
+    //no SA_RESTART: a wait for a key gives up, and read_key then writes the report right away
+    memory_report_action.sa_flags = 0;
+    sigaction(SIGUSR1, &memory_report_action, NULL);
+    if (screen_interactive() && input_script == NULL) {
+        //headless, policy driven and scripted games carry on from a fight without stopping for a key
+        show_combat = show_combat_screen;
+    }
+    struct timespec start_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    if (load_file != NULL) {
+        //the terminal only fits tiles of the default size
+        if (load_snapshot(load_file) != 0
+            || (!screen_headless && (tile_width_x != DEFAULT_TILE_WIDTH_X || tile_length_y != DEFAULT_TILE_LENGTH_Y))) {
+            screen_end();
+            fprintf(stderr, "Could not load the snapshot %s\n", load_file);
+            exit(EXIT_FAILURE);
+        }
+        struct timespec load_time;
+        clock_gettime(CLOCK_MONOTONIC, &load_time);
+        fprintf(stderr, "loaded %d tiles from %s in %.1f ms, state %016llx\n", num_resident_tiles, load_file,
+                (load_time.tv_sec - start_time.tv_sec) * 1e3 + (load_time.tv_nsec - start_time.tv_nsec) / 1e6,
+                (unsigned long long) state_hash());
+        loaded_turns = turns_taken;
+    }
+    else {
+        struct tile *home_tile = malloc(sizeof(struct tile));
+        *home_tile = create_tile(WORLD_CENTER_X, WORLD_CENTER_Y);
+        current_tile_x = WORLD_CENTER_X;
+        current_tile_y = WORLD_CENTER_Y;
+        world[WORLD_CENTER_Y][WORLD_CENTER_X] = home_tile;
+        add_resident_tile(home_tile);
+        summarize_tile(home_tile);
+        place_player_character(world[current_tile_y][current_tile_x]);
+    }
     while (turn_based_movement() == -1) {
-        //-1 signals map was changed: call turn_based_movement for new map/turn heap
-        //old and new tile and heap have been updated correctly in change tile (removed from old heap in turn_based_movement)
+        //-1 signals the PC changed tiles: change_tile suspended the old tile and moved the PC into the turn heap
+        //of the new one, which resume_tile brought up to the PC's time, so the loop carries on with that heap
     }
-    endwin();
-    return 0;
+    screen_end();
+    int status = EXIT_SUCCESS;
+    uint64_t hash = state_hash();
+    if (save_file != NULL) {
+        struct timespec save_start_time;
+        struct timespec save_end_time;
+        clock_gettime(CLOCK_MONOTONIC, &save_start_time);
+        if (save_snapshot(save_file, hash) != 0) {
+            fprintf(stderr, "Could not save the snapshot %s\n", save_file);
+            status = EXIT_FAILURE;
+        }
+        else {
+            clock_gettime(CLOCK_MONOTONIC, &save_end_time);
+            fprintf(stderr, "saved %d tiles to %s in %.1f ms, state %016llx\n", num_resident_tiles, save_file,
+                    (save_end_time.tv_sec - save_start_time.tv_sec) * 1e3
+                    + (save_end_time.tv_nsec - save_start_time.tv_nsec) / 1e6,
+                    (unsigned long long) hash);
+        }
+    }
+    if (journal != NULL) {
+        fprintf(journal, "turns %ld\nhash %016llx\n", turns_taken - loaded_turns, (unsigned long long) hash);
+        fclose(journal);
+    }
+    if (replay_keys != NULL) {
+        if (replay_has_hash) {
+            printf("replay %s: %ld of %ld keys, state %016llx %s\n", replay_file, next_replay_key, num_replay_keys,
+                   (unsigned long long) hash, hash == replay_hash ? "matches the journal" : "DIFFERS from the journal");
+            if (hash != replay_hash) {
+                status = EXIT_FAILURE;
+            }
+        }
+        else {
+            printf("replay %s: %ld of %ld keys, state %016llx, no hash in the journal to check against\n",
+                   replay_file, next_replay_key, num_replay_keys, (unsigned long long) hash);
+        }
+    }
+    if (!screen_interactive()) {
+        print_headless_summary(seed, &start_time);
+    }
+    if (input_script != NULL) {
+        struct timespec end_time;
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        double seconds = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+        printf("input %s: %ld keys from %ld lines in %.3f s, %.0f keys/s\n", input_file, input_keys_read,
+               input_lines_read, seconds, seconds > 0 ? input_keys_read / seconds : 0.0);
+        if (input_script != stdin) {
+            fclose(input_script);
+        }
+    }
+    if (screen_output != NULL && screen_active()) {
+        long frames;
+        long bytes;
+        screen_stats(&frames, &bytes);
+        printf("screen %s: %ld frames, %ld bytes, %.0f bytes and %.1f us per map frame\n",
+               screen_backend == SCREEN_BACKEND_ANSI ? "ansi" : "ncurses", frames, bytes,
+               frames > 0 ? (double) bytes / frames : 0.0, show_tile_calls > 0 ? show_tile_seconds * 1e6 / show_tile_calls : 0.0);
+    }
+    if (world_pool != NULL) {
+        pool_destroy(world_pool);
+    }
+#ifdef HEAP_STATS
+    print_heap_stats();
+#endif
+    if (print_stats) {
+        print_phase_stats();
+    }
+    if (print_memory) {
+        print_memory_report(stderr);
+    }
+    return status;
 
 }
 
 int print_usage() {
 
     //print expected inputs
+    fprintf(stderr, "Usage: Pokemon [options]\n");
+    fprintf(stderr, "  -t, --numtrainers N   trainers per tile (0 to %d, default 10; crowded tiles get fewer)\n",
+            MAX_NUM_TRAINERS);
+    fprintf(stderr, "  -H, --headless        run without a terminal; the PC is driven by --policy\n");
+    fprintf(stderr, "  -n, --turns N         stop after N character turns (default %d when headless)\n",
+            HEADLESS_DEFAULT_TURNS);
+    fprintf(stderr, "  -p, --policy P        headless PC policy: random (default) or seek\n");
+    fprintf(stderr, "  -s, --seed S          seed the world instead of using the clock\n");
+    fprintf(stderr, "  -w, --world-threads N keep every generated tile moving, simulated on N threads\n");
+    fprintf(stderr, "  -S, --tile-size WxH   headless tile size (default %dx%d)\n",
+            DEFAULT_TILE_WIDTH_X, DEFAULT_TILE_LENGTH_Y);
+    fprintf(stderr, "  -j, --journal FILE    record the seed and every key to FILE\n");
+    fprintf(stderr, "  -r, --replay FILE     replay a journal headless as fast as possible and check its final state\n");
+    fprintf(stderr, "  -o, --save FILE       write every generated tile, trainer and the PC to FILE on quitting\n");
+    fprintf(stderr, "  -l, --load FILE       carry on from a --save snapshot instead of generating a new world\n");
+    fprintf(stderr, "  -d, --screen B        draw with ncurses (default) or ansi, raw escapes diffed against the last frame\n");
+    fprintf(stderr, "  -O, --screen-output FILE\n");
+    fprintf(stderr, "                        draw every frame to FILE, with the PC driven by --policy, and report\n");
+    fprintf(stderr, "                        the bytes written and the time spent per frame\n");
+    fprintf(stderr, "  -i, --input FILE      play the keys of a script from FILE, or - for standard input when headless,\n");
+    fprintf(stderr, "                        then quit and report the keys read per second; script lines are\n");
+    fprintf(stderr, "                        keys TEXT, repeat N TEXT (\\e is escape), key CODE|escape|up|down,\n");
+    fprintf(stderr, "                        delay MS before every key, wait MS once, and # comments\n");
+    fprintf(stderr, "  -T, --stats           print p50 and p99 times of tile generation, pathfinding, trainer\n");
+    fprintf(stderr, "                        behaviors and drawing on exit, in builds with PHASE_STATS on\n");
+    fprintf(stderr, "  -M, --memory          print an estimate of the bytes held by tiles, characters and heaps on exit;\n");
+    fprintf(stderr, "                        kill -USR1 prints the same report at the next turn, or appends it\n");
+    fprintf(stderr, "                        to " MEMORY_REPORT_FILE " while the map is on the terminal\n");
 
     return 0;
 
@@ -196,277 +451,293 @@ int print_usage() {
 
 int initialize_terminal() {
 
-    initscr();
-    raw();
-    noecho();
-    curs_set(0);
-    keypad(stdscr, TRUE);
+    if (screen_init() != 0) {
+        return 1;
+    }
+    //a color pair per terrain id, then one per character type, from the colors the terrain and characters carry
+    for (int id = 0; id < NUM_TERRAINS; id++) {
+        screen_init_color(1 + id, terrains_by_id[id]->color);
+        terrain_cells[id] = screen_cell(terrains_by_id[id]->printable_character, 1 + id);
+    }
+    for (int type = 0; type < NUM_CHARACTER_TYPES; type++) {
+        screen_init_color(1 + NUM_TERRAINS + type, character_colors[type]);
+        character_cells[type] = screen_cell(character_printable_characters[type], 1 + NUM_TERRAINS + type);
+    }
 
     return 0;
 
 }
 
-int turn_based_movement() {
+int read_key() {
 
-    struct tile *tile = world[current_tile_y][current_tile_x];
-    struct heap *turn_heap = tile->turn_heap;
-    static struct character *character;
-    while ((character = heap_remove_min(turn_heap))) {
-        if (character->type_enum == PLAYER) {
-            clear();
-            addstr("It's your turn! Enter a command or press z for help!\n");
-            print_tile_terrain(tile);
-            refresh();
-            int result = player_turn(turn_heap);
-            if (result != 0) {
-                 return result;
-            }
+    //keys come from a journal being replayed, an input script, the terminal, or the PC policy when there is no terminal
+    int key;
+    if (replay_keys != NULL) {
+        key = replay_key();
+    }
+    else if (input_script != NULL) {
+        key = script_key();
+    }
+    else if (!screen_interactive()) {
+        key = policy_key();
+    }
+    else {
+        key = screen_get_key();
+        while (key == -1 && memory_report_requested) {
+            answer_memory_report_request();
+            key = screen_get_key();
         }
-        else if (character->type_enum == RIVAL) {
-            if (character->defeated == 1) {
-                //no longer paths to PC
-                character->turn += MINIMUM_TURN;
-            } else {
-                //find a legal point to change_tile to
-                int new_x;
-                int new_y;
-                int new_distance = INT_MAX;
-                for (int x = -1; x <= 1; x++) {
-                    for (int y = -1; y <= 1; y++) {
-                        int candidate_x = character->x + x;
-                        int candidate_y = character->y + y;
-                        if (candidate_x > 0 && candidate_x < TILE_WIDTH_X && candidate_y > 0 &&
-                            candidate_y < TILE_LENGTH_Y
-                            && rival_distance_tile[candidate_y][candidate_x] != INT_MAX
-                            && (tile->tile[candidate_y][candidate_x].character == NULL
-                                || (tile->tile[candidate_y][candidate_x].character->type_enum == PLAYER &&
-                                    character->defeated == 0))) {
-                            if (rival_distance_tile[candidate_y][candidate_x] < new_distance) {
-                                new_x = candidate_x;
-                                new_y = candidate_y;
-                                new_distance = rival_distance_tile[candidate_y][candidate_x];
-                            }
-                        }
-                    }
-                }
-                if (new_distance != INT_MAX) {
-                    //if legal point to move to found, change_tile there
-                    move_character(character->x, character->y, new_x, new_y);
-                    character->turn += tile->tile[new_y][new_x].terrain.rival_weight;
-                } else {
-                    //no legal point to change_tile to found
-                    character->turn += MINIMUM_TURN;
-                }
-            }
+    }
+    if (journal != NULL) {
+        fprintf(journal, "key %d\n", key);
+    }
+    return key;
+
+}
+
+int replay_key() {
+
+    if (next_replay_key < num_replay_keys) {
+        return replay_keys[next_replay_key++];
+    }
+    return quit_key();
+
+}
+
+int quit_key() {
+
+    //out of keys: escape whatever screen is up, then quit from the map
+    static const int quit_keys[] = {SCREEN_KEY_ESCAPE, 'Q', 'y'};
+    static int next_quit_key = 0;
+    return quit_keys[next_quit_key++ % 3];
+
+}
+
+int script_key() {
+
+    while (next_input_key >= num_input_keys) {
+        if (input_repeats > 0) {
+            input_repeats--;
+            next_input_key = 0;
         }
-        else if (character->type_enum == HIKER) {
-            if (character->defeated == 1) {
-                //no longer paths to PC
-                character->turn += MINIMUM_TURN;
-            }
-            else {
-                int new_x;
-                int new_y;
-                int new_distance = INT_MAX;
-                for (int x = -1; x <= 1; x++) {
-                    for (int y = -1; y <= 1; y++) {
-                        int candidate_x = character->x + x;
-                        int candidate_y = character->y + y;
-                        if (candidate_x > 0 && candidate_x < TILE_WIDTH_X && candidate_y > 0 &&
-                            candidate_y < TILE_LENGTH_Y
-                            && hiker_distance_tile[candidate_y][candidate_x] != INT_MAX
-                            && (tile->tile[candidate_y][candidate_x].character == NULL
-                                || (tile->tile[candidate_y][candidate_x].character->type_enum == PLAYER &&
-                                    character->defeated == 0))) {
-                            if (hiker_distance_tile[candidate_y][candidate_x] < new_distance) {
-                                new_x = candidate_x;
-                                new_y = candidate_y;
-                                new_distance = hiker_distance_tile[candidate_y][candidate_x];
-                            }
-                        }
-                    }
-                }
-                if (new_distance != INT_MAX) {
-                    move_character(character->x, character->y, new_x, new_y);
-                    character->turn += tile->tile[new_y][new_x].terrain.hiker_weight;
-                } else {
-                    character->turn += MINIMUM_TURN;
-                }
-            }
+        else if (read_script_line() != 0) {
+            return quit_key();
         }
-        else if (character->type_enum == RANDOM_WALKER) {
-            int new_x = character->x + character->x_direction;
-            int new_y = character->y + character->y_direction;
-            //if we have a direction set and can continue in it
-            if (character->direction_set == 1 && new_x > 0 && new_x < TILE_WIDTH_X && new_y > 0 && new_y < TILE_LENGTH_Y
-            && tile->tile[new_y][new_x].terrain.rival_weight != INT_MAX
-            && (tile->tile[new_y][new_x].character == NULL
-            || (tile->tile[new_y][new_x].character->type_enum == PLAYER && character->defeated == 0))) {
-                move_character(character->x, character->y, new_x, new_y);
-                character->turn += tile->tile[new_y][new_x].terrain.rival_weight;
-            }
-            //no direction set or can't continue in set direction
-            else {
-                //if at least 1 direction legal, choose randomly until legal direction is found
-                int has_possible_direction = 0;
-                for (int y = -1; y <= 1; y++) {
-                    for (int x = -1; x <= 1; x++) {
-                        if (x != 0 || y != 0) {
-                            if (tile->tile[character->y + y][character->x + x].terrain.rival_weight != INT_MAX
-                            && (tile->tile[character->y + y][character->x + x].character == NULL
-                            || (tile->tile[character->y + y][character->x + x].character->type_enum == PLAYER
-                            && character->defeated == 0))) {
-                                has_possible_direction = 1;
-                            }
-                        }
-                    }
-                }
-                if (has_possible_direction == 1) {
-                    int found = 0;
-                    int x;
-                    int y;
-                    while (found == 0) {
-                        x = rand() % 3 - 1;
-                        y = rand() % 3 - 1;
-                        new_x = character->x + x;
-                        new_y = character->y + y;
-                        if ((x != 0 || y != 0) && new_x > 0 && new_x < TILE_WIDTH_X && new_y > 0 && new_y < TILE_LENGTH_Y
-                        && tile->tile[new_y][new_x].terrain.rival_weight != INT_MAX
-                        && (tile->tile[new_y][new_x].character == NULL
-                        || (tile->tile[new_y][new_x].character->type_enum == PLAYER && character->defeated == 0))) {
-                            found = 1;
-                        }
-                    }
-                    character->x_direction = x;
-                    character->y_direction = y;
-                    character->direction_set = 1;
-                    move_character(character->x, character->y, new_x, new_y);
-                    character->turn += tile->tile[new_y][new_x].terrain.rival_weight;
-                }
-                else {
-                    character->turn += MINIMUM_TURN;
-                }
-            }
+    }
+    if (input_delay > 0) {
+        sleep_milliseconds(input_delay);
+    }
+    input_keys_read++;
+    return input_keys[next_input_key++];
+
+}
+
+int read_script_line() {
+
+    //reads lines until one with keys, which go into input_keys; returns 1 once the script is over
+    static char *line = NULL;
+    static size_t line_capacity = 0;
+    ssize_t length;
+    //SIGUSR1 doesn't restart system calls, and getline would drop a line it interrupts
+    sigset_t memory_report_signal;
+    sigemptyset(&memory_report_signal);
+    sigaddset(&memory_report_signal, SIGUSR1);
+    while (1) {
+        sigprocmask(SIG_BLOCK, &memory_report_signal, NULL);
+        length = getline(&line, &line_capacity, input_script);
+        sigprocmask(SIG_UNBLOCK, &memory_report_signal, NULL);
+        if (length == -1) {
+            break;
+        }
+        input_lines_read++;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
         }
-        else if (character->type_enum == PACER) {
-            int new_x = character->x + character->x_direction;
-            int new_y = character->y + character->y_direction;
-            //change_tile in direction
-            if (character->direction_set == 1 && new_x > 0 && new_x < TILE_WIDTH_X && new_y > 0 && new_y < TILE_LENGTH_Y
-                && tile->tile[new_y][new_x].terrain.rival_weight != INT_MAX
-                && (tile->tile[new_y][new_x].character == NULL || tile->tile[new_y][new_x].character->type_enum == PLAYER)) {
-                move_character(character->x, character->y, new_x, new_y);
-                character->turn += tile->tile[new_y][new_x].terrain.rival_weight;
+        if (input_keys_capacity < length + 1) {
+            input_keys_capacity = length + 1;
+            input_keys = realloc(input_keys, input_keys_capacity * sizeof(int));
+        }
+        num_input_keys = 0;
+        next_input_key = 0;
+        input_repeats = 0;
+        int offset = 0;
+        int key;
+        long milliseconds;
+        char name[COMMAND_MAX_SIZE];
+        const char *text = NULL;
+        if (length == 0 || line[0] == '#') {
+            continue;
+        }
+        else if (strncmp(line, "keys ", 5) == 0) {
+            text = line + 5;
+        }
+        else if (sscanf(line, "repeat %ld %n", &input_repeats, &offset) == 1 && offset > 0 && input_repeats > 0) {
+            //the line is played once here and input_repeats more times by script_key
+            input_repeats--;
+            text = line + offset;
+        }
+        else if (sscanf(line, "key %d %n", &key, &offset) == 1 && offset == length) {
+            input_keys[num_input_keys++] = key;
+        }
+        else if (sscanf(line, "key %255s %n", name, &offset) == 1 && offset == length
+                 && (strcmp(name, "escape") == 0 || strcmp(name, "up") == 0 || strcmp(name, "down") == 0)) {
+            input_keys[num_input_keys++] = strcmp(name, "escape") == 0 ? SCREEN_KEY_ESCAPE
+                                           : strcmp(name, "up") == 0 ? SCREEN_KEY_UP : SCREEN_KEY_DOWN;
+        }
+        else if (sscanf(line, "delay %ld %n", &milliseconds, &offset) == 1 && offset == length && milliseconds >= 0) {
+            input_delay = milliseconds;
+        }
+        else if (sscanf(line, "wait %ld %n", &milliseconds, &offset) == 1 && offset == length && milliseconds >= 0) {
+            sleep_milliseconds(milliseconds);
+        }
+        else {
+            screen_end();
+            fprintf(stderr, "%s line %ld: \"%s\" is not a script line\n", input_file, input_lines_read, line);
+            exit(EXIT_FAILURE);
+        }
+        for (; text != NULL && *text != '\0'; text++) {
+            if (text[0] == '\\' && text[1] == 'e') {
+                input_keys[num_input_keys++] = SCREEN_KEY_ESCAPE;
+                text++;
             }
-            //reverse direction
-            else if (character->direction_set == 1) {
-                character->x_direction *= -1;
-                character->y_direction *= -1;
-                int new_x = character->x + character->x_direction;
-                int new_y = character->y + character->y_direction;
-                move_character(character->x, character->y, new_x, new_y);
+            else if (text[0] == '\\' && text[1] == '\\') {
+                input_keys[num_input_keys++] = '\\';
+                text++;
             }
-            //no direction yet
             else {
-                //if at least 1 direction legal, choose randomly until legal direction is found
-                int has_possible_direction = 0;
-                for (int y = -1; y <= 1; y++) {
-                    for (int x = -1; x <= 1; x++) {
-                        if (x != 0 || y != 0) {
-                            if (tile->tile[character->y + y][character->x + x].terrain.rival_weight != INT_MAX
-                            && (tile->tile[character->y + y][character->x + x].character == NULL
-                            || (tile->tile[character->y + y][character->x + x].character->type_enum == PLAYER
-                            && character->defeated == 0))) {
-                                has_possible_direction = 1;
-                            }
-                        }
-                    }
-                }
-                if (has_possible_direction == 1) {
-                    int found = 0;
-                    int x;
-                    int y;
-                    while (found == 0) {
-                        x = rand() % 3 - 1;
-                        y = rand() % 3 - 1;
-                        new_x = character->x + x;
-                        new_y = character->y + y;
-                        if ((x != 0 || y != 0) && new_x > 0 && new_x < TILE_WIDTH_X && new_y > 0 && new_y < TILE_LENGTH_Y
-                            && tile->tile[new_y][new_x].terrain.rival_weight != INT_MAX
-                            && (tile->tile[new_y][new_x].character == NULL
-                            || (tile->tile[new_y][new_x].character == PLAYER && character->defeated == 0))) {
-                            found = 1;
-                        }
-                    }
-                    character->x_direction = x;
-                    character->y_direction = y;
-                    character->direction_set = 1;
-                    move_character(character->x, character->y, new_x, new_y);
-                    character->turn += tile->tile[new_y][new_x].terrain.rival_weight;
-                }
-                else {
-                    character->turn += MINIMUM_TURN;
-                }
+                input_keys[num_input_keys++] = (unsigned char) *text;
             }
         }
-        else if (character->type_enum == WANDERER) {
-            int new_x = character->x + character->x_direction;
-            int new_y = character->y + character->y_direction;
-            if (character->direction_set == 1 && new_x > 0 && new_x < TILE_WIDTH_X && new_y > 0 && new_y < TILE_LENGTH_Y
-                && tile->tile[new_y][new_x].terrain.id == tile->tile[character->y][character->x].terrain.id
-                && (tile->tile[new_y][new_x].character == NULL
-                || (tile->tile[new_y][new_x].character->type_enum == PLAYER && character->defeated == 0))) {
-                move_character(character->x, character->y, new_x, new_y);
-                character->turn += tile->tile[new_y][new_x].terrain.rival_weight;
-            }
-            else {
-                //if at least 1 direction legal, choose randomly until legal direction is found
-                int has_possible_direction = 0;
-                for (int y = -1; y <= 1; y++) {
-                    for (int x = -1; x <= 1; x++) {
-                        if (x != 0 || y != 0) {
-                            if ((tile->tile[character->y + y][character->x + x].terrain.id
-                            == tile->tile[character->y][character->x].terrain.id)
-                            && (tile->tile[character->y][character->x].character == NULL
-                            || (tile->tile[character->y][character->x].character == PLAYER && character->defeated == 0))) {
-                                has_possible_direction = 1;
-                            }
-                        }
-                    }
-                }
-                if (has_possible_direction == 1) {
-                    int found = 0;
-                    int x;
-                    int y;
-                    while (found == 0) {
-                        x = rand() % 3 - 1;
-                        y = rand() % 3 - 1;
-                        new_x = character->x + x;
-                        new_y = character->y + y;
-                        if ((x != 0 || y != 0) && new_x > 0 && new_x < TILE_WIDTH_X && new_y > 0 && new_y < TILE_LENGTH_Y
-                            && tile->tile[new_y][new_x].terrain.id == tile->tile[character->y][character->x].terrain.id
-                            && (tile->tile[new_y][new_x].character == NULL
-                            || (tile->tile[new_y][new_x].character->type_enum == PLAYER && character->defeated == 0))) {
-                            found = 1;
-                        }
-                    }
-                    character->x_direction = x;
-                    character->y_direction = y;
-                    character->direction_set = 1;
-                    move_character(character->x, character->y, new_x, new_y);
-                    character->turn += tile->tile[new_y][new_x].terrain.rival_weight;
-                }
-                else {
-                    character->turn += MINIMUM_TURN;
-                }
+        if (num_input_keys > 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+
+}
+
+int sleep_milliseconds(long milliseconds) {
+
+    //whatever the script waits on should be on screen while it does
+    screen_refresh();
+    struct timespec duration = {milliseconds / 1000, milliseconds % 1000 * 1000000L};
+    nanosleep(&duration, NULL);
+
+    return 0;
+
+}
+
+int load_replay(char *file, unsigned int *seed, int *numtrainers, int *world_threads) {
+
+    FILE *replay = fopen(file, "r");
+    if (replay == NULL) {
+        return 1;
+    }
+    int capacity = 1024;
+    replay_keys = malloc(capacity * sizeof(int));
+    char line[COMMAND_MAX_SIZE];
+    while (fgets(line, sizeof(line), replay) != NULL) {
+        int key;
+        unsigned long long hash;
+        if (sscanf(line, "key %d", &key) == 1) {
+            if (num_replay_keys == capacity) {
+                capacity *= 2;
+                replay_keys = realloc(replay_keys, capacity * sizeof(int));
+            }
+            replay_keys[num_replay_keys++] = key;
+        }
+        else if (sscanf(line, "hash %llx", &hash) == 1) {
+            replay_hash = hash;
+            replay_has_hash = 1;
+        }
+        else if (sscanf(line, "seed %u", seed) != 1
+                 && sscanf(line, "numtrainers %d", numtrainers) != 1
+                 && sscanf(line, "tile-size %dx%d", &tile_width_x, &tile_length_y) != 2
+                 && sscanf(line, "world-threads %d", world_threads) != 1
+                 && sscanf(line, "load %ms", &load_file) != 1
+                 && sscanf(line, "turns %ld", &max_turns) != 1) {
+            fclose(replay);
+            return 1;
+        }
+    }
+    fclose(replay);
+
+    return 0;
+
+}
+
+int policy_key() {
+
+    //escape is in the mix so that screens waiting for it (like the trainer list) are left again
+    static const int random_keys[] = {'1', '2', '3', '4', '6', '7', '8', '9', '5', SCREEN_KEY_ESCAPE};
+    static const int direction_keys[3][3] = {{'7', '8', '9'}, {'4', '5', '6'}, {'1', '2', '3'}};
+    if (policy == POLICY_SEEK && rand_r(&policy_random_state) % 4 != 0) {
+        //head for the closest trainer that can still be battled
+        struct tile *tile = world[current_tile_y][current_tile_x];
+        int trainer = nearest_trainer(tile, player_character->x, player_character->y, 1);
+        if (trainer != -1) {
+            int dx = tile->trainers.x[trainer] - player_character->x;
+            int dy = tile->trainers.y[trainer] - player_character->y;
+            return direction_keys[(dy > 0) - (dy < 0) + 1][(dx > 0) - (dx < 0) + 1];
+        }
+    }
+    return random_keys[rand_r(&policy_random_state) % (sizeof(random_keys) / sizeof(random_keys[0]))];
+
+}
+
+int print_headless_summary(unsigned int seed, struct timespec *start_time) {
+
+    struct timespec end_time;
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    double seconds = (end_time.tv_sec - start_time->tv_sec) + (end_time.tv_nsec - start_time->tv_nsec) / 1e9;
+    long world_turns = 0;
+    for (int i = 0; i < num_resident_tiles; i++) {
+        world_turns += resident_tiles[i]->turns_simulated;
+    }
+    printf("seed %u: %ld turns (%ld by the PC) on %d tiles in %.3f s, %.0f turns/s\n",
+           seed, turns_taken, pc_turns_taken, num_resident_tiles, seconds, seconds > 0 ? (turns_taken - loaded_turns) / seconds : 0.0);
+    if (world_pool != NULL) {
+        printf("world simulation: %ld turns on tiles the PC was not on, %.0f turns/s\n",
+               world_turns, seconds > 0 ? world_turns / seconds : 0.0);
+    }
+
+    return 0;
+
+}
+
+int turn_based_movement() {
+
+    struct tile *tile = world[current_tile_y][current_tile_x];
+    struct heap *turn_heap = tile->turn_heap;
+    static int *turn;
+    //characters stay in the heap while taking their turn and are moved to their new turn in place afterwards
+    while ((turn = heap_peek_min(turn_heap))) {
+        if (max_turns >= 0 && turns_taken - loaded_turns >= max_turns) {
+            return 1;
+        }
+        if (memory_report_requested) {
+            answer_memory_report_request();
+        }
+        turns_taken++;
+        if (turn == &player_character->turn) {
+            pc_turns_taken++;
+            if (world_pool != NULL) {
+                //every other tile catches up to the PC before the PC acts
+                simulate_world(tile, player_character->turn + tile->turn_offset);
+            }
+            show_tile(tile, "It's your turn! Enter a command or press z for help!\n");
+            int result = player_turn(turn_heap);
+            if (result != 0) {
+                 return result;
             }
+            reschedule(turn_heap, player_character->heap_node);
         }
-        else if (character->type_enum == STATIONARY) {
-            character->turn += MINIMUM_TURN;
+        else {
+            trainer_turn(tile, turn);
         }
-        heap_insert(turn_heap, character);
     }
-    heap_delete(turn_heap);
+    //the turn heap belongs to the tile and is kept for when the PC comes back
 
     return 0;
 
@@ -480,7 +751,7 @@ int player_turn() {
     int x = player_character->x;
     int y = player_character->y;
     while (turn_completed == 0) {
-        int input = getch();
+        int input = read_key();
         int moving = 0;
         int new_x = x;
         int new_y = y;
@@ -514,420 +785,194 @@ int player_turn() {
             moving = 1;
             new_x--;
         } else if (input == '>') {
-            if (tile->tile[y][x].terrain.id == center.id) {
+            if (tile->tile[CELL(x, y)].terrain.id == center.id) {
                 enter_center(player_character);
-            } else if (tile->tile[y][x].terrain.id == mart.id) {
+            } else if (tile->tile[CELL(x, y)].terrain.id == mart.id) {
                 enter_mart(player_character);
             } else {
-                clear();
-                addstr("There is no pokecenter or pokemart here so you can't enter one!\n");
-                print_tile_terrain(tile);
+                show_tile(tile, "There is no pokecenter or pokemart here so you can't enter one!\n");
             }
         } else if (input == '<') {
             if (player_character->in_building == 1) {
-                clear();
-                addstr("You have left the building!\n");
-                print_tile_terrain(tile);
+                show_tile(tile, "You have left the building!\n");
             } else {
-                clear();
-                addstr("You aren't in a building so you can't leave one!\n");
-                print_tile_terrain(tile);
+                show_tile(tile, "You aren't in a building so you can't leave one!\n");
             }
         } else if (input == '5' || input == ' ' || input == '.') {
             player_character->turn += MINIMUM_TURN;
             turn_completed = 1;
         } else if (input == 't') {
-            struct character *trainers [num_trainers];
-            int count = 0;
-            for (int i = 1; i < TILE_LENGTH_Y - 1; i++) {
-                for (int j = 1; j < TILE_WIDTH_X - 1; j++) {
-                    struct character *character = tile->tile[i][j].character;
-                    if (character != NULL && character->type_enum != PLAYER) {
-                        trainers[count] = character;
-                        count++;
-                    }
-                }
-            }
+            //the tile's trainer registry lists every trainer without scanning the map
+            //trainers can't move while the list is open, so it is sorted once and only the visible page is formatted
+            int count = tile->trainers.count;
+            uint64_t *trainer_list = malloc((count > 0 ? count : 1) * sizeof(uint64_t));
+            for (int i = 0; i < count; i++) {
+                int distance_x = tile->trainers.x[i] - player_character->x;
+                int distance_y = tile->trainers.y[i] - player_character->y;
+                trainer_list[i] = (uint64_t) (distance_x * distance_x + distance_y * distance_y) << 32 | i;
+            }
+            qsort(trainer_list, count, sizeof(uint64_t), comparator_trainer_list);
             int position = 0;
-            int screen_row = 1;
-            int type_x = 0;
-            int position_x = 19;
-            int defeated_status_x = 40;
-            clear();
-            addstr("Trainer list: Press escape to return to the map\n");
-            for (int i = position; i < position + SCREEN_HEIGHT - 1 && i < num_trainers; i++) {
-                struct character *trainer = trainers[i];
-                mvaddstr(screen_row, type_x, trainer->type_string);
-                mvaddstr(screen_row, position_x, " ");
-                if (trainer->y != player_character->y) {
-                    char y_distance[3];
-                    if (trainer->y < player_character->y) {
-                        sprintf(y_distance, "%d ", player_character->y - trainer->y);
-                        addstr(y_distance);
-                        addstr("North ");
-                    }
-                    else {
-                        sprintf(y_distance, "%d ", trainer->y - player_character->y);
-                        addstr(y_distance);
-                        addstr("South ");
-                    }
-                }
-                if (trainer->x != player_character->x) {
-                    char x_distance[3];
-                    if (trainer->x < player_character->x) {
-                        sprintf(x_distance, "%d ", player_character->x - trainer->x);
-                        addstr(x_distance);
-                        addstr("West");
-                    }
-                    else {
-                        sprintf(x_distance, "%d ", trainer->x - player_character->x);
-                        addstr(x_distance);
-                        addstr("East");
-                    }
-                }
-                if (trainer->defeated == 1) {
-                    mvaddstr(screen_row, defeated_status_x, "Defeated");
-                }
-                addstr("\n");
-                screen_row++;
-            }
-            refresh();
+            screen_clear();
+            show_trainer_list(tile, trainer_list, count, position, "Trainer list: Press escape to return to the map\n");
             int command = -1;
-            while (command != 27 && command != ACS_UARROW && command != ACS_DARROW) {
-                command = getch();
-                screen_row = 1;
-                if (command == 27) {
+            while (command != SCREEN_KEY_ESCAPE) {
+                command = read_key();
+                if (command == SCREEN_KEY_ESCAPE) {
                     turn_completed = 1;
                 }
-                else if (command == KEY_UP) {
-                    //xtodo: BUG TEST: test scroll up
-                    if (position > 1) {
-                        position -= SCREEN_HEIGHT - 1;
+                else if (command == SCREEN_KEY_UP) {
+                    if (position > 0) {
+                        position -= TRAINER_LIST_ROWS;
                         if (position < 0) {
                             position = 0;
                         }
-                        clear();
-                        addstr("Trainer list: Press escape to return to the map\n");
-                        for (int i = position; i < position + SCREEN_HEIGHT - 1 && i < num_trainers; i++) {
-                            struct character *trainer = trainers[i];
-                            mvaddstr(screen_row, type_x, trainer->type_string);
-                            mvaddstr(screen_row, position_x, " ");
-                            if (trainer->y != player_character->y) {
-                                char y_distance[3];
-                                if (trainer->y < player_character->y) {
-                                    sprintf(y_distance, "%d ", player_character->y - trainer->y);
-                                    addstr(y_distance);
-                                    addstr("North ");
-                                }
-                                else {
-                                    sprintf(y_distance, "%d ", trainer->y - player_character->y);
-                                    addstr(y_distance);
-                                    addstr("South ");
-                                }
-                            }
-                            if (trainer->x != player_character->x) {
-                                char x_distance[3];
-                                if (trainer->x < player_character->x) {
-                                    sprintf(x_distance, "%d ", player_character->x - trainer->x);
-                                    addstr(x_distance);
-                                    addstr("West");
-                                }
-                                else {
-                                    sprintf(x_distance, "%d ", trainer->x - player_character->x);
-                                    addstr(x_distance);
-                                    addstr("East");
-                                }
-                            }
-                            if (trainer->defeated == 1) {
-                                mvaddstr(screen_row, defeated_status_x, "Defeated");
-                            }
-                            addstr("\n");
-                            screen_row++;
-                        }
-                        refresh();
+                        show_trainer_list(tile, trainer_list, count, position, "Trainer list: Press escape to return to the map\n");
                     }
                     else {
-                        clear();
-                        addstr("You are already at the top of the list so you cannot scroll up.\n");
-                        for (int i = position; i < position + SCREEN_HEIGHT - 1 && i < num_trainers; i++) {
-                            struct character *trainer = trainers[i];
-                            mvaddstr(screen_row, type_x, trainer->type_string);
-                            mvaddstr(screen_row, position_x, " ");
-                            if (trainer->y != player_character->y) {
-                                char y_distance[3];
-                                if (trainer->y < player_character->y) {
-                                    sprintf(y_distance, "%d ", player_character->y - trainer->y);
-                                    addstr(y_distance);
-                                    addstr("North ");
-                                }
-                                else {
-                                    sprintf(y_distance, "%d ", trainer->y - player_character->y);
-                                    addstr(y_distance);
-                                    addstr("South ");
-                                }
-                            }
-                            if (trainer->x != player_character->x) {
-                                char x_distance[3];
-                                if (trainer->x < player_character->x) {
-                                    sprintf(x_distance, "%d ", player_character->x - trainer->x);
-                                    addstr(x_distance);
-                                    addstr("West");
-                                }
-                                else {
-                                    sprintf(x_distance, "%d ", trainer->x - player_character->x);
-                                    addstr(x_distance);
-                                    addstr("East");
-                                }
-                            }
-                            if (trainer->defeated == 1) {
-                                mvaddstr(screen_row, defeated_status_x, "Defeated");
-                            }
-                            addstr("\n");
-                            screen_row++;
-                        }
-                        refresh();
+                        show_trainer_list(tile, trainer_list, count, position, "You are already at the top of the list so you cannot scroll up.\n");
                     }
                 }
-                else if (command == KEY_DOWN) {
-                    if (position < num_trainers - SCREEN_HEIGHT + 1) {
-                        position += SCREEN_HEIGHT - 1;
-                        clear();
-                        addstr("Trainer list: Press escape to return to the map\n");
-                        for (int i = position; i < position + SCREEN_HEIGHT - 1 && i < num_trainers; i++) {
-                            struct character *trainer = trainers[i];
-                            mvaddstr(screen_row, type_x, trainer->type_string);
-                            mvaddstr(screen_row, position_x, " ");
-                            if (trainer->y != player_character->y) {
-                                char y_distance[3];
-                                if (trainer->y < player_character->y) {
-                                    sprintf(y_distance, "%d ", player_character->y - trainer->y);
-                                    addstr(y_distance);
-                                    addstr("North ");
-                                }
-                                else {
-                                    sprintf(y_distance, "%d ", trainer->y - player_character->y);
-                                    addstr(y_distance);
-                                    addstr("South ");
-                                }
-                            }
-                            if (trainer->x != player_character->x) {
-                                char x_distance[3];
-                                if (trainer->x < player_character->x) {
-                                    sprintf(x_distance, "%d ", player_character->x - trainer->x);
-                                    addstr(x_distance);
-                                    addstr("West");
-                                }
-                                else {
-                                    sprintf(x_distance, "%d ", trainer->x - player_character->x);
-                                    addstr(x_distance);
-                                    addstr("East");
-                                }
-                            }
-                            if (trainer->defeated == 1) {
-                                mvaddstr(screen_row, defeated_status_x, "Defeated");
-                            }
-                            addstr("\n");
-                            screen_row++;
-                        }
-                        refresh();
+                else if (command == SCREEN_KEY_DOWN) {
+                    if (position + TRAINER_LIST_ROWS < count) {
+                        position += TRAINER_LIST_ROWS;
+                        show_trainer_list(tile, trainer_list, count, position, "Trainer list: Press escape to return to the map\n");
                     }
                     else {
-                        clear();
-                        addstr("You are already at the bottom of the list so you cannot scroll down.\n");
-                        for (int i = position; i < position + SCREEN_HEIGHT - 1 && i < num_trainers; i++) {
-                            struct character *trainer = trainers[i];
-                            mvaddstr(screen_row, type_x, trainer->type_string);
-                            mvaddstr(screen_row, position_x, " ");
-                            if (trainer->y != player_character->y) {
-                                char y_distance[3];
-                                if (trainer->y < player_character->y) {
-                                    sprintf(y_distance, "%d ", player_character->y - trainer->y);
-                                    addstr(y_distance);
-                                    addstr("North ");
-                                }
-                                else {
-                                    sprintf(y_distance, "%d ", trainer->y - player_character->y);
-                                    addstr(y_distance);
-                                    addstr("South ");
-                                }
-                            }
-                            if (trainer->x != player_character->x) {
-                                char x_distance[3];
-                                if (trainer->x < player_character->x) {
-                                    sprintf(x_distance, "%d ", player_character->x - trainer->x);
-                                    addstr(x_distance);
-                                    addstr("West");
-                                }
-                                else {
-                                    sprintf(x_distance, "%d ", trainer->x - player_character->x);
-                                    addstr(x_distance);
-                                    addstr("East");
-                                }
-                            }
-                            if (trainer->defeated == 1) {
-                                mvaddstr(screen_row, defeated_status_x, "Defeated");
-                            }
-                            addstr("\n");
-                            screen_row++;
-                        }
-                        refresh();
+                        show_trainer_list(tile, trainer_list, count, position, "You are already at the bottom of the list so you cannot scroll down.\n");
                     }
                 }
                 else {
                     //command is invalid
-                    clear();
-                    addstr("That is not a valid command! Press escape to return to the map.\n");
-                    for (int i = position; i < position + SCREEN_HEIGHT - 1 && i < num_trainers; i++) {
-                        struct character *trainer = trainers[i];
-                        mvaddstr(screen_row, type_x, trainer->type_string);
-                        mvaddstr(screen_row, position_x, " ");
-                        if (trainer->y != player_character->y) {
-                            char y_distance[3];
-                            if (trainer->y < player_character->y) {
-                                sprintf(y_distance, "%d ", player_character->y - trainer->y);
-                                addstr(y_distance);
-                                addstr("North ");
-                            }
-                            else {
-                                sprintf(y_distance, "%d ", trainer->y - player_character->y);
-                                addstr(y_distance);
-                                addstr("South ");
-                            }
-                        }
-                        if (trainer->x != player_character->x) {
-                            char x_distance[3];
-                            if (trainer->x < player_character->x) {
-                                sprintf(x_distance, "%d ", player_character->x - trainer->x);
-                                addstr(x_distance);
-                                addstr("West");
-                            }
-                            else {
-                                sprintf(x_distance, "%d ", trainer->x - player_character->x);
-                                addstr(x_distance);
-                                addstr("East");
-                            }
-                        }
-                        if (trainer->defeated == 1) {
-                            mvaddstr(screen_row, defeated_status_x, "Defeated");
-                        }
-                        addstr("\n");
-                        screen_row++;
+                    show_trainer_list(tile, trainer_list, count, position, "That is not a valid command! Press escape to return to the map.\n");
+                }
+            }
+            free(trainer_list);
+        } else if (input == 'm') {
+            //the minimap starts on the PC's tile and pans a quarter of its window per key
+            int center_x = current_tile_x;
+            int center_y = current_tile_y;
+            screen_clear();
+            show_minimap(center_x, center_y, "World map: Move to pan the map, press escape to return\n");
+            int command = -1;
+            while (command != SCREEN_KEY_ESCAPE) {
+                command = read_key();
+                int direction = key_direction(command);
+                if (command == SCREEN_KEY_ESCAPE) {
+                    show_tile(tile, "It's your turn! Enter a command or press z for help!\n");
+                }
+                else if (direction != -1) {
+                    int new_center_x = center_x + direction_x[direction] * (MINIMAP_COLUMNS / 4);
+                    int new_center_y = center_y + direction_y[direction] * (MINIMAP_ROWS / 4);
+                    if (new_center_x >= 0 && new_center_x < WORLD_WIDTH_X && new_center_y >= 0 && new_center_y < WORLD_LENGTH_Y) {
+                        center_x = new_center_x;
+                        center_y = new_center_y;
+                        show_minimap(center_x, center_y, "World map: Move to pan the map, press escape to return\n");
                     }
-                    refresh();
+                    else {
+                        show_minimap(center_x, center_y, "That is the edge of the world so the map cannot pan there.\n");
+                    }
+                }
+                else {
+                    show_minimap(center_x, center_y, "That is not a valid command! Press escape to return to the map.\n");
                 }
             }
         } else if (input == 'Q') {
-            clear();
-            addstr("Are you sure you want to quit (y/n)? All progress will be lost.\n");
-            refresh();
+            screen_clear();
+            screen_print("Are you sure you want to quit (y/n)? All progress will be lost.\n");
+            screen_refresh();
             int quit = -1;
             while (quit != 'y' || quit != 'n') {
-                quit = getch();
+                quit = read_key();
                 if (quit == 'y') {
                     return 1;
                 } else if (quit == 'n') {
-                    clear();
-                    addstr("It's your turn! Enter a command or press z for help!\n");
-                    print_tile_terrain(tile);
+                    show_tile(tile, "It's your turn! Enter a command or press z for help!\n");
                 } else {
-                    clear();
-                    addstr("Please enter (y/n) to quit. If you quit all progress will be lost.\n");
-                    refresh();
+                    screen_clear();
+                    screen_print("Please enter (y/n) to quit. If you quit all progress will be lost.\n");
+                    screen_refresh();
                 }
             }
         } else if (input == 'z') {
             if (in_help == 0) {
                 //enter help
-                clear();
-                addstr("Enter z to enter/leave the help menu.\n");
-                addstr("Enter 9 or u to move one cell to the upper right.\n");
-                addstr("Enter 8 or k to move one cell up.\n");
-                addstr("Enter 7 or y to move one cell to the upper left.\n");
-                addstr("Enter 6 or l to move one cell to the right.\n");
-                addstr("Enter 5 or space or . to rest for a turn.\n");
-                addstr("Enter 4 or h to move one cell to the left.\n");
-                addstr("Enter 3 or n to move one cell to the lower right.\n");
-                addstr("Enter 2 or j to move one cell down.\n");
-                addstr("Enter 1 or b to move one cell to the lower left.\n");
-                addstr("Enter > to enter a pokemart or pokecenter.\n");
-                addstr("Enter < to leave a pokemart or pokecenter.\n");
-                addstr("Enter t to display a list of trainers.\n");
-                addstr("Enter up arrow to scroll up on the trainer list.\n");
-                addstr("Enter down arrow to scroll up on the trainer list.\n");
-                addstr("Enter escape to leave the trainer list.\n");
-                addstr("Enter Q to quit the game.\n");
-                refresh();
+                screen_clear();
+                screen_print("Enter z to enter/leave the help menu.\n");
+                screen_print("Enter 9 or u to move one cell to the upper right.\n");
+                screen_print("Enter 8 or k to move one cell up.\n");
+                screen_print("Enter 7 or y to move one cell to the upper left.\n");
+                screen_print("Enter 6 or l to move one cell to the right.\n");
+                screen_print("Enter 5 or space or . to rest for a turn.\n");
+                screen_print("Enter 4 or h to move one cell to the left.\n");
+                screen_print("Enter 3 or n to move one cell to the lower right.\n");
+                screen_print("Enter 2 or j to move one cell down.\n");
+                screen_print("Enter 1 or b to move one cell to the lower left.\n");
+                screen_print("Enter > to enter a pokemart or pokecenter.\n");
+                screen_print("Enter < to leave a pokemart or pokecenter.\n");
+                screen_print("Enter t to display a list of trainers.\n");
+                screen_print("Enter up arrow to scroll up on the trainer list.\n");
+                screen_print("Enter down arrow to scroll up on the trainer list.\n");
+                screen_print("Enter escape to leave the trainer list.\n");
+                screen_print("Enter m to display the world map, which the movement keys pan.\n");
+                screen_print("Enter Q to quit the game.\n");
+                screen_refresh();
             }
             else {
                 //exit help
-                clear();
-                addstr("It's your turn! Enter a command or press z for help!\n");
-                print_tile_terrain(tile);
+                show_tile(tile, "It's your turn! Enter a command or press z for help!\n");
             }
             in_help = 1 - in_help;
         } else {
-            clear();
-            addstr("That is not a valid command. Enter z for help!\n");
-            print_tile_terrain(tile);
-            refresh();
+            show_tile(tile, "That is not a valid command. Enter z for help!\n");
         }
 
         //call movement function if moving
         if (moving == 1) {
             //if terrain can be crossed
-            if (tile->tile[new_y][new_x].terrain.pc_weight == INT_MAX) {
-                clear();
-                addstr("You can't cross that kind of terrain!\n");
-                print_tile_terrain(tile);
+            if (tile->tile[CELL(new_x, new_y)].terrain.pc_weight == INT_MAX) {
+                show_tile(tile, "You can't cross that kind of terrain!\n");
             }
             //if there is an undefeated trainer there
-            else if (tile->tile[new_y][new_x].character != NULL && tile->tile[new_y][new_x].character->defeated != 0) {
-                clear();
-                addstr("You have already defeated that trainer so they are too scared to battle you again!");
-                print_tile_terrain(tile);
+            else if (cell_occupied(tile, new_x, new_y)
+                     && tile->trainers.flags[tile->tile[CELL(new_x, new_y)].character] & TRAINER_DEFEATED) {
+                show_tile(tile, "You have already defeated that trainer so they are too scared to battle you again!");
             }
             //if you are exiting the map
             else if (new_y == 0 || new_y == TILE_LENGTH_Y - 1 || new_x == 0 || new_x == TILE_WIDTH_X - 1) {
-                //todo: BUG TEST: test moving onto new tile
-                //todo: BUG TEST: test moving onto new tile with large game time for trainers time being updated correctly
+                //the old tile keeps its turn heap; change_tile takes the PC out of it and into the new tile's
                 if (change_tile(tile->x + new_x - x, tile->y + new_y - y) == 0) {
-                    tile->tile[y][x].character = NULL;
+                    vacate_cell(tile, x, y);
                     //tile in this function is new tile
                     tile = world[current_tile_y][current_tile_x];
                     //successfully changed tiles
                     //updates PC coordinates
-                    //todo: BUG: character enters new map on opposite side (same side of map as left old map)
-                    //todo: BUG: going back to old map actually creates a new map replacing old map
                     if (new_x == 0) {
                         player_character->x = TILE_WIDTH_X - 2;
-                    } else if (new_x == TILE_WIDTH_X) {
+                    } else if (new_x == TILE_WIDTH_X - 1) {
                         player_character->x = 1;
                     } else if (new_y == 0) {
                         player_character->y = TILE_LENGTH_Y - 2;
-                    } else if (new_y == TILE_LENGTH_Y) {
+                    } else if (new_y == TILE_LENGTH_Y - 1) {
                         player_character->y = 1;
                     }
-                    //todo: BUG: tell old point that character is gone now
-                    tile->tile[player_character->y][player_character->x].character = player_character;
+                    //a trainer may be standing where the PC arrives: never stack two characters on a cell
+                    nearest_free_cell(tile, &player_character->x, &player_character->y);
+                    occupy_cell(tile, player_character->x, player_character->y, PC_CHARACTER);
                     //refactors trainer distance tiles
                     dijkstra(tile, RIVAL);
                     dijkstra(tile, HIKER);
                     //tells turn_based_movement that we have changed tiles
                     return -1;
-                    //todo: ASSIGNED: make new heap for this tile (attach heap to tile)
                 }
                 else {
-                    //todo: BUG TEST: test trying to move off of edge of world
                     //cannot change tile because at edge of world
-                    clear();
-                    addstr("You can't go off of the edge of the world like that! It's your turn! Enter a command or press z for help!\n");
-                    print_tile_terrain(tile);
-                    refresh();
+                    show_tile(tile, "You can't go off of the edge of the world like that! It's your turn! Enter a command or press z for help!\n");
                 }
             }
             else {
-                move_character(x, y, new_x, new_y);
-                player_character->turn += tile->tile[new_y][new_x].terrain.pc_weight;
+                move_character(tile, x, y, new_x, new_y);
+                player_character->turn += tile->tile[CELL(new_x, new_y)].terrain.pc_weight;
                 //recreate distance tiles for new PC location
                 dijkstra(tile, RIVAL);
                 dijkstra(tile, HIKER);
@@ -939,73 +984,12 @@ int player_turn() {
 
 }
 
-int move_character(int x, int y, int new_x, int new_y) {
-
-    struct tile *tile = world[current_tile_y][current_tile_x];
-    struct character *from_character = tile->tile[y][x].character;
-    struct character *to_character = tile->tile[new_y][new_x].character;
-    //if moving onto PC
-    if (to_character != NULL) {
-        //pc-trainer combat instigated by either party
-        if (from_character->type_enum == PLAYER || to_character->type_enum == PLAYER) {
-            if (from_character->type_enum == PLAYER && to_character->defeated == 1) {
-                //PC should not be allowed to move to a defeated trainer's location (as of assignment 1.05)
-                return 2;
-            }
-            else {
-                combat(from_character, to_character);
-            }
-        }
-        //trainer -> trainer = no move
-        else {
-            //this should never happen because this is checked in turn_based_movement in trainer movement
-            return 1;
-        }
-    }
-    else {
-        tile->tile[y][x].character->x = new_x;
-        tile->tile[y][x].character->y = new_y;
-        struct character *temp_character = tile->tile[y][x].character;
-        tile->tile[y][x].character = NULL;
-        tile->tile[new_y][new_x].character = temp_character;
-    }
-    return 0;
-
-}
-
-int combat(struct character *from_character, struct character *to_character) {
-
-    if (from_character->type_enum == PLAYER) {
-        //player attacks trainer
-        to_character->defeated = 1;
-        clear();
-        addstr("Victory! You challenged a trainer to a duel and defeated them soundly! Press escape to leave.\n");
-        refresh();
-    }
-    else {
-        from_character->defeated = 1;
-        //trainer attacks player
-        clear();
-        addstr("Victory! A trainer challenged you to a duel and you trounced them! Press escape to leave.\n");
-        refresh();
-    }
-    int command = -1;
-    while (command != 27) {
-        command = getch();
-        clear();
-        addstr("Invalid command. Press press escape to stop your victory dance after defeating that trainer.\n");
-        refresh();
-    }
-    return 0;
-
-}
-
 int enter_center() {
 
     player_character->in_building = 1;
-    clear();
-    addstr("You are in a pokecenter! Unfortunately this center is rather barren. Leave by entering \'<\'\n");
-    refresh();
+    screen_clear();
+    screen_print("You are in a pokecenter! Unfortunately this center is rather barren. Leave by entering \'<\'\n");
+    screen_refresh();
 
     return 0;
 
@@ -1014,9 +998,9 @@ int enter_center() {
 int enter_mart() {
 
     player_character->in_building = 1;
-    clear();
-    addstr("You are in a pokemart! Unfortunately this mart is rather barren. Leave by entering \'<\'\n");
-    refresh();
+    screen_clear();
+    screen_print("You are in a pokemart! Unfortunately this mart is rather barren. Leave by entering \'<\'\n");
+    screen_refresh();
 
     return 0;
 
@@ -1156,870 +1140,394 @@ int interaction(struct heap *turn_heap) {
 
 }
 
-int change_tile(int x, int y) {
-
-    //todo: ASSIGNED: upon entering map set all trainers there to same heap time as PC
-    if (x >= 0 && x < WORLD_WIDTH_X && y >= 0 && y < WORLD_LENGTH_Y) {
-        if (world[y][x] == NULL) {
-            struct tile *new_tile = (malloc(sizeof(struct tile)));
-            *new_tile = create_tile(x, y);
-            world[y][x] = new_tile;
-        }
-        world[current_tile_y][current_tile_x]->player_character = NULL;
-        current_tile_x = x;
-        current_tile_y = y;
-        world[current_tile_y][current_tile_x]->player_character = player_character;
-        heap_insert(world[current_tile_y][current_tile_x]->turn_heap, player_character);
-        return 0;
-    }
-    else {
-        return 1;
-    }
-
-}
+int show_combat_screen(int from_character, int to_character) {
 
-struct tile create_tile(int x, int y) {
-
-    struct tile tile = create_empty_tile();
-    tile.x = x;
-    tile.y = y;
-    generate_terrain(&tile);
-    int north_x;
-    if (y > 0 && world[y - 1][x] != NULL) {
-        //north_x = world[y - 1][x]->south_x;
-    }
-    else {
-        north_x = rand() % (TILE_WIDTH_X - 10) + 5;
-    }
-    int south_x;
-    if (y < WORLD_LENGTH_Y - 1 && world[y + 1][x] != NULL) {
-        //south_x = world[y + 1][x]->north_x;
-    }
-    else {
-        south_x = rand() % (TILE_WIDTH_X - 10) + 5;
-    }
-    int east_y;
-    if (x < WORLD_WIDTH_X - 1 && world[y][x + 1] != NULL) {
-        //east_y = world[y][x + 1]->west_y;
-    }
-    else {
-        east_y = rand() % (TILE_LENGTH_Y - 10) + 5;
-    }
-    int west_y;
-    if (x > 0 && world[y][x - 1] != NULL) {
-        //west_y = world[y][x - 1]->east_y;
+    //only installed for a player at the terminal, whose keys it reads straight from there: they change nothing,
+    //so they stay out of the journal, and a replay, which never shows this screen, doesn't expect them
+    (void) to_character;
+    screen_clear();
+    if (from_character == PC_CHARACTER) {
+        //player attacks trainer
+        screen_print("Victory! You challenged a trainer to a duel and defeated them soundly! Press escape to leave.\n");
     }
     else {
-        west_y = rand() % (TILE_LENGTH_Y - 10) + 5;
+        //trainer attacks player
+        screen_print("Victory! A trainer challenged you to a duel and you trounced them! Press escape to leave.\n");
     }
-    generate_paths(&tile, north_x, south_x, east_y, west_y);
-    generate_buildings(&tile, x, y);
-    place_trainers(&tile);
-    return tile;
-
-}
-
-struct tile create_empty_tile() {
-
-    struct tile tile;
-    struct point empty_point =
-            {-1, -1,none, none, NULL, INT_MAX, NULL};
-    for (int i = 0; i < TILE_LENGTH_Y; i++) {
-        for (int j = 0; j < TILE_WIDTH_X; j++) {
-            tile.tile[i][j] = empty_point;
-            tile.tile[i][j].x = j;
-            tile.tile[i][j].y = i;
+    screen_refresh();
+    int command = screen_get_key();
+    while (command != SCREEN_KEY_ESCAPE) {
+        if (command == -1) {
+            //the wait was cut short by SIGUSR1, or there are no keys left to wait for
+            if (!memory_report_requested) {
+                break;
+            }
+            answer_memory_report_request();
         }
+        else {
+            screen_clear();
+            screen_print("Invalid command. Press escape to stop your victory dance after defeating that trainer.\n");
+            screen_refresh();
+        }
+        command = screen_get_key();
     }
-    tile.north_x = -1;
-    tile.south_x = -1;
-    tile.east_y = -1;
-    tile.west_y = -1;
-    struct heap turn_heap;
-    heap_init(&turn_heap, comparator_character_movement, NULL);
-    tile.turn_heap = &turn_heap;
-    return tile;
-
-}
-
-int generate_terrain(struct tile *tile) {
-
-    const int NUM_TALL_GRASS_SEEDS = rand() % 5 + 2;
-    const int NUM_CLEARING_SEEDS = rand() % 5 + 2;
-    const int NUM_FOREST_SEEDS = rand() % 5;
-    const int NUM_MOUNTAIN_SEEDS = rand() % 4;
-    const int NUM_LAKE_SEEDS = rand() % 3;
-    plant_seeds(tile, grass, NUM_TALL_GRASS_SEEDS);
-    plant_seeds(tile, clearing, NUM_CLEARING_SEEDS);
-    plant_seeds(tile, forest, NUM_FOREST_SEEDS);
-    plant_seeds(tile, mountain, NUM_MOUNTAIN_SEEDS);
-    plant_seeds(tile, lake, NUM_LAKE_SEEDS);
-    grow_seeds(tile);
-    place_edge(tile);
-    set_terrain_border_weights(tile);
 
     return 0;
 
 }
 
-int plant_seeds(struct tile *tile, struct terrain terrain, int num_seeds) {
+int print_tile_terrain(struct tile *tile) {
 
-    for (int i = 0; i < num_seeds; i++) {
-        int placed = 0;
-        while (placed == 0) {
-            int x = rand() % (TILE_WIDTH_X - 2) + 1;
-            int y = rand() % (TILE_LENGTH_Y - 2) + 1;
-            if (tile->tile[y][x].terrain.id == none.id) {
-                tile->tile[y][x].terrain = terrain;
-                placed = 1;
-            }
-        }
-    }
+    draw_tile_terrain(tile);
+    screen_refresh();
 
     return 0;
 
 }
 
-int grow_seeds(struct tile *tile) {
-
-    //queue implementation:
-    //add each (coordinate, terrain) tuple structure to queue
-    //while queue not empty
-    //pop
-    //if does not have terrain
-    //give terrain as specified in tuple
-    //give space weight value for dijkstra (as defined earlier)
-    //add all spaces within 3x and 1y to queue with same terrain
-
-    //loop through non-edge to grow seeds
-    int complete = 0;
-    while (complete == 0) {
-        //if no changes made in a loop then no more loops required
-        complete = 1;
-        //determine what must grow
-        for (int i = 1; i < TILE_LENGTH_Y - 1; i++) {
-            for (int j = 1; j < TILE_WIDTH_X - 1; j++) {
-                if (tile->tile[i][j].terrain.id == none.id) {
-                    //loop through nearby area to copy first terrain found
-                    for (int k = -1; k <=1; k++) {
-                        for (int l = -1; l <= 1; l++) {
-                            int x = j+k;
-                            int y = i+l;
-                            if (x > 0 && x < TILE_WIDTH_X - 1 && y > 0 && y < TILE_LENGTH_Y - 1) {
-                                struct terrain new_terrain = tile->tile[y][x].terrain;
-                                if (new_terrain.id != none.id) {
-                                    tile->tile[i][j].grow_into = new_terrain;
-                                }
-                            }
-                        }
-                    }
-                    complete = 0;
-                }
-            }
-        }
-        //grow what must grow
-        for (int i = 1; i < TILE_LENGTH_Y - 1; i++) {
-            for (int j = 1; j < TILE_WIDTH_X - 1; j++) {
-                struct terrain new_terrain = tile->tile[i][j].grow_into;
-                if (new_terrain.id != none.id) {
-                    tile->tile[i][j].terrain = new_terrain;
-                }
-            }
+int draw_tile_terrain(struct tile *tile) {
+
+    if (!screen_active()) {
+        return 0;
+    }
+
+    //a full redraw of the map; show_tile's time includes it along with the redraws of only the changed cells
+    TIMER_START(start);
+    screen_cell_t row[TILE_WIDTH_X];
+    for (int y = 0; y < TILE_LENGTH_Y; y++) {
+        for (int x = 0; x < TILE_WIDTH_X; x++) {
+            row[x] = tile_cell(tile, x, y);
         }
+        screen_put_cells(y + 1, 0, row, TILE_WIDTH_X);
     }
+    //drawing cells leaves the cursor alone, so it is put back below the map for whatever prints next
+    screen_print_at(TILE_LENGTH_Y + 1, 0, "");
+    TIMER_STOP(start, &phase_timers[PHASE_DRAW_TILE_TERRAIN]);
 
     return 0;
 
 }
 
-int place_edge(struct tile *tile) {
+screen_cell_t tile_cell(struct tile *tile, int x, int y) {
 
-    //places edge (stones with different name and higher weight) on edges
-    for (int i = 0; i < TILE_WIDTH_X; i ++) {
-        tile->tile[0][i].terrain = edge;
-        tile->tile[TILE_LENGTH_Y - 1][i].terrain = edge;
+    int character = tile->tile[CELL(x, y)].character;
+    if (character == PC_CHARACTER) {
+        return character_cells[PLAYER];
     }
-    for (int i = 0; i < TILE_LENGTH_Y; i ++) {
-        tile->tile[i][0].terrain = edge;
-        tile->tile[i][TILE_WIDTH_X - 1].terrain = edge;
+    else if (character != NO_CHARACTER) {
+        return character_cells[tile->trainers.type_enum[character]];
     }
-
-    return 0;
+    return terrain_cells[tile->tile[CELL(x, y)].terrain.id];
 
 }
 
-int set_terrain_border_weights(struct tile *tile) {
-
-    //Sets borders between non-edge terrain types to weight 0
-    for (int i = 1; i < TILE_LENGTH_Y - 1; i++) {
-        for (int j = 1; j < TILE_WIDTH_X - 1; j++) {
-            struct terrain terrain = tile->tile[i][j].terrain;
-            for (int k = -1; k <=1; k++) {
-                for (int l = -1; l <= 1; l++) {
-                    int x = j+k;
-                    int y = i+l;
-                    if (x > 0 && x < TILE_WIDTH_X - 1 && y > 0 && y < TILE_LENGTH_Y - 1) {
-                        struct terrain other_terrain = tile->tile[y][x].terrain;
-                        if (terrain.id != other_terrain.id && other_terrain.id != edge.id) {
-                            tile->tile[i][j].terrain.path_weight = TERRAIN_BORDER_WEIGHT;
-                        }
-                    }
+int show_tile(struct tile *tile, const char *message) {
+
+    if (!screen_active()) {
+        return 0;
+    }
+
+    TIMER_START(start);
+    struct timespec start_time;
+    struct timespec end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    //the map stays on screen between turns: unless something else was drawn over it, only the message line
+    //and the cells characters left or entered are drawn again
+    //a message as wide as the screen wraps onto the map, so it gets a full redraw as well
+    if (tile != drawn_tile || screen_clear_count() != drawn_clear_count
+        || (int) strcspn(message, "\n") >= TILE_WIDTH_X) {
+        screen_clear();
+        screen_print(message);
+        draw_tile_terrain(tile);
+        drawn_tile = tile;
+        drawn_clear_count = screen_clear_count();
+        memset(tile->dirty, 0, TILE_LENGTH_Y * OCCUPANCY_WORDS * sizeof(uint64_t));
+    }
+    else {
+        screen_print_line(0, message);
+        for (int y = 0; y < TILE_LENGTH_Y; y++) {
+            for (int word = 0; word < OCCUPANCY_WORDS; word++) {
+                uint64_t bits = tile->dirty[y * OCCUPANCY_WORDS + word];
+                tile->dirty[y * OCCUPANCY_WORDS + word] = 0;
+                while (bits != 0) {
+                    int x = word * 64 + __builtin_ctzll(bits);
+                    screen_cell_t cell = tile_cell(tile, x, y);
+                    screen_put_cells(y + 1, x, &cell, 1);
+                    bits &= bits - 1;
                 }
             }
         }
     }
+    screen_frame();
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    show_tile_seconds += (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    show_tile_calls++;
+    TIMER_STOP(start, &phase_timers[PHASE_SHOW_TILE]);
 
     return 0;
 
 }
 
-int generate_paths(struct tile *tile, int north_x, int south_x, int east_y, int west_y) {
-
-    north_x = 39;
-    south_x = 39;
-    west_y = 10;
-    east_y = 10;
-
-    //used in both paths:
-    int current_x;
-    int current_y;
-    //x = none; n = north; s = south; e = east; w = west
-    char last_move;
-    int moves_since_last_change;
-    const int repetitive_limit = 3;
-
-    //North/South path
-    current_x = north_x;
-    current_y = 0;
-    last_move = 'x';
-    moves_since_last_change = 0;
-    tile->tile[current_y][current_x].terrain = path;
-    while (current_y < TILE_LENGTH_Y - 2) {
-        //determine weights
-        int east_weight = INT_MAX;
-        int west_weight = INT_MAX;
-        int south_weight = INT_MAX;
-        if (current_x < TILE_WIDTH_X - 4 && last_move != 'w'
-            && !(moves_since_last_change > repetitive_limit && last_move == 'e')) {
-            east_weight = tile->tile[current_y][current_x + 1].terrain.path_weight;
-        }
-        if (current_x > 2 && last_move != 'e' && !(moves_since_last_change > repetitive_limit && last_move == 'w')) {
-            west_weight = tile->tile[current_y][current_x - 1].terrain.path_weight;
-        }
-        if (current_y < TILE_LENGTH_Y - 1 && !(moves_since_last_change > repetitive_limit && last_move == 's')) {
-            south_weight = tile->tile[current_y + 1][current_x].terrain.path_weight;
-        }
-        //choose the lowest weight
-        if (east_weight < west_weight && east_weight < south_weight) {
-            current_x++;
-            tile->tile[current_y][current_x].terrain = path;
-            if (last_move == 'e') {
-                moves_since_last_change++;
-            }
-            else {
-                last_move = 'e';
-                moves_since_last_change = 0;
-            }
-        }
-        else if (west_weight < south_weight) {
-            current_x--;
-            tile->tile[current_y][current_x].terrain = path;
-            if (last_move == 'w') {
-                moves_since_last_change++;
-            }
-            else {
-                last_move = 'w';
-                moves_since_last_change = 0;
+int show_trainer_list(struct tile *tile, uint64_t *trainer_list, int count, int position, const char *message) {
+
+    //every row of the page is rewritten whole, so scrolling needs no clear and costs one page however long the list is
+    int position_x = 19;
+    int defeated_status_x = 40;
+    screen_print_line(0, message);
+    for (int screen_row = 1; screen_row <= TRAINER_LIST_ROWS; screen_row++) {
+        int i = position + screen_row - 1;
+        char line[COMMAND_MAX_SIZE] = "";
+        if (i < count) {
+            int trainer = trainer_list[i] & 0xffffffff;
+            int distance_x = tile->trainers.x[trainer] - player_character->x;
+            int distance_y = tile->trainers.y[trainer] - player_character->y;
+            int length = snprintf(line, sizeof(line), "%-*s ", position_x, character_type_strings[tile->trainers.type_enum[trainer]]);
+            if (distance_y != 0) {
+                length += snprintf(line + length, sizeof(line) - length, "%d %s ", abs(distance_y), distance_y < 0 ? "North" : "South");
+            }
+            if (distance_x != 0) {
+                length += snprintf(line + length, sizeof(line) - length, "%d %s", abs(distance_x), distance_x < 0 ? "West" : "East");
+            }
+            if (tile->trainers.flags[trainer] & TRAINER_DEFEATED) {
+                snprintf(line + length, sizeof(line) - length, "%*s", defeated_status_x - length + 8, "Defeated");
             }
         }
-        else {
-            current_y++;
-            tile->tile[current_y][current_x].terrain = path;
-            if (last_move == 's') {
-                moves_since_last_change++;
-            }
-            else {
-                last_move = 's';
-                moves_since_last_change = 0;
-            }
-        }
-    }
-    if (current_x < south_x) {
-        for (int i = current_x; i <= south_x; i++) {
-            current_x = i;
-            tile->tile[current_y][current_x].terrain = path;
-        }
-    }
-    else if (current_x > south_x) {
-        for (int i = current_x; i >= south_x; i--) {
-            current_x = i;
-            tile->tile[current_y][current_x].terrain = path;
-        }
+        screen_print_line(screen_row, line);
     }
-    tile->tile[current_y + 1][current_x].terrain = path;
-
-    //West/East path
-    current_x = 0;
-    current_y = west_y;
-    last_move = 'x';
-    moves_since_last_change = 0;
-    tile->tile[current_y][current_x].terrain = path;
-    while (current_x < TILE_WIDTH_X - 2) {
-        //determine weights
-        int north_weight = INT_MAX;
-        int south_weight = INT_MAX;
-        int east_weight = INT_MAX;
-        if (current_y < TILE_LENGTH_Y - 3 && last_move != 'n'
-            && !(moves_since_last_change > repetitive_limit && last_move == 's')) {
-            south_weight = tile->tile[current_y + 1][current_x].terrain.path_weight;
-        }
-        if (current_y > 2 && last_move != 's' && !(moves_since_last_change > repetitive_limit && last_move == 'n')) {
-            north_weight = tile->tile[current_y - 1][current_x].terrain.path_weight;
-        }
-        if (current_x < TILE_WIDTH_X - 2 && !(moves_since_last_change > repetitive_limit && last_move == 'e')) {
-            east_weight = tile->tile[current_y][current_x + 1].terrain.path_weight;
-        }
-        //choose the lowest weight
-        if (north_weight < south_weight && north_weight < east_weight) {
-            current_y--;
-            tile->tile[current_y][current_x].terrain = path;
-            if (last_move == 'n') {
-                moves_since_last_change++;
-            }
-            else {
-                last_move = 'n';
-                moves_since_last_change = 0;
-            }
-        }
-        else if (south_weight < east_weight) {
-            current_y++;
-            tile->tile[current_y][current_x].terrain = path;
-            if (last_move == 's') {
-                moves_since_last_change++;
-            }
-            else {
-                last_move = 's';
-                moves_since_last_change = 0;
-            }
-        }
-        else {
-            current_x++;
-            tile->tile[current_y][current_x].terrain = path;
-            if (last_move == 'e') {
-                moves_since_last_change++;
-            }
-            else {
-                last_move = 'e';
-                moves_since_last_change = 0;
-            }
-        }
-    }
-    if (current_y < east_y) {
-        for (int i = current_y; i <= east_y; i++) {
-            current_y = i;
-            tile->tile[current_y][current_x].terrain = path;
-        }
-    }
-    else if (current_y > east_y) {
-        for (int i = current_y; i >= east_y; i--) {
-            current_y = i;
-            tile->tile[current_y][current_x].terrain = path;
-        }
-    }
-    tile->tile[current_y][current_x + 1].terrain = path;
-
-    tile->north_x = north_x;
-    tile->south_x = south_x;
-    tile->west_y = west_y;
-    tile ->east_y = east_y;
-
-    //uncomment below and modify it to match paths across tiles.
-//    //used in both paths:
-//    int current_x;
-//    int current_y;
-//    //x = none; n = north; s = south; e = east; w = west
-//    char last_move;
-//    int moves_since_last_change;
-//    const int repetitive_limit = 3;
-//
-//    //North/South path
-//    current_x = north_x;
-//    current_y = 0;
-//    last_move = 'x';
-//    moves_since_last_change = 0;
-//    tile->tile[current_y][current_x].terrain = terrain_path;
-//    while (current_y < TILE_LENGTH_Y - 2) {
-//        //determine weights
-//        int east_weight = INT_MAX;
-//        int west_weight = INT_MAX;
-//        int south_weight = INT_MAX;
-//        if (current_x < TILE_WIDTH_X - 4 && last_move != 'w'
-//            && !(moves_since_last_change > repetitive_limit && last_move == 'e')) {
-//            east_weight = tile->tile[current_y][current_x + 1].weight;
-//        }
-//        if (current_x > 2 && last_move != 'e' && !(moves_since_last_change > repetitive_limit && last_move == 'w')) {
-//            west_weight = tile->tile[current_y][current_x - 1].weight;
-//        }
-//        if (current_y < TILE_LENGTH_Y - 1 && !(moves_since_last_change > repetitive_limit && last_move == 's')) {
-//            south_weight = tile->tile[current_y + 1][current_x].weight;
-//        }
-//        //choose lowest weight
-//        if (east_weight < west_weight && east_weight < south_weight) {
-//            current_x++;
-//            tile->tile[current_y][current_x].terrain = terrain_path;
-//            if (last_move == 'e') {
-//                moves_since_last_change++;
-//            }
-//            else {
-//                last_move = 'e';
-//                moves_since_last_change = 0;
-//            }
-//        }
-//        else if (west_weight < south_weight) {
-//            current_x--;
-//            tile->tile[current_y][current_x].terrain = terrain_path;
-//            if (last_move == 'w') {
-//                moves_since_last_change++;
-//            }
-//            else {
-//                last_move = 'w';
-//                moves_since_last_change = 0;
-//            }
-//        }
-//        else {
-//            current_y++;
-//            tile->tile[current_y][current_x].terrain = terrain_path;
-//            if (last_move == 's') {
-//                moves_since_last_change++;
-//            }
-//            else {
-//                last_move = 's';
-//                moves_since_last_change = 0;
-//            }
-//        }
-//    }
-//    tile->tile[current_y + 1][current_x].terrain = terrain_path;
-//
-//    //West/East path
-//    current_x = 0;
-//    current_y = west_y;
-//    last_move = 'x';
-//    moves_since_last_change = 0;
-//    tile->tile[current_y][current_x].terrain = terrain_path;
-//    while (current_x < TILE_WIDTH_X - 2) {
-//        //determine weights
-//        int north_weight = INT_MAX;
-//        int south_weight = INT_MAX;
-//        int east_weight = INT_MAX;
-//        if (current_y < TILE_LENGTH_Y - 3 && last_move != 'n'
-//            && !(moves_since_last_change > repetitive_limit && last_move == 's')) {
-//            south_weight = tile->tile[current_y + 1][current_x].weight;
-//        }
-//        if (current_y > 2 && last_move != 's' && !(moves_since_last_change > repetitive_limit && last_move == 'n')) {
-//            north_weight = tile->tile[current_y - 1][current_x].weight;
-//        }
-//        if (current_x < TILE_WIDTH_X - 2 && !(moves_since_last_change > repetitive_limit && last_move == 'e')) {
-//            east_weight = tile->tile[current_y][current_x + 1].weight;
-//        }
-//        //choose lowest weight
-//        if (north_weight < south_weight && north_weight < east_weight) {
-//            current_y--;
-//            tile->tile[current_y][current_x].terrain = terrain_path;
-//            if (last_move == 'n') {
-//                moves_since_last_change++;
-//            }
-//            else {
-//                last_move = 'n';
-//                moves_since_last_change = 0;
-//            }
-//        }
-//        else if (south_weight < east_weight) {
-//            current_y++;
-//            tile->tile[current_y][current_x].terrain = terrain_path;
-//            if (last_move == 's') {
-//                moves_since_last_change++;
-//            }
-//            else {
-//                last_move = 's';
-//                moves_since_last_change = 0;
-//            }
-//        }
-//        else {
-//            current_x++;
-//            tile->tile[current_y][current_x].terrain = terrain_path;
-//            if (last_move == 'e') {
-//                moves_since_last_change++;
-//            }
-//            else {
-//                last_move = 'e';
-//                moves_since_last_change = 0;
-//            }
-//        }
-//    }
-//    tile->tile[current_y][current_x + 1].terrain = terrain_path;
-//
-//    tile->north_x = north_x;
-//    tile->south_x = south_x;
-//    tile->west_y = west_y;
-//    tile ->east_y = east_y;
+    screen_refresh();
 
     return 0;
 
 }
 
-int generate_buildings(struct tile *tile, int x, int y) {
+screen_cell_t summary_cell(int x, int y) {
 
-    double chance;
-    if (x == WORLD_CENTER_X && y == WORLD_CENTER_Y) {
-        chance = 100;
+    if (x < 0 || x >= WORLD_WIDTH_X || y < 0 || y >= WORLD_LENGTH_Y
+        || !(tile_summaries[y][x].flags & TILE_SUMMARY_GENERATED)) {
+        return screen_cell(' ', 0);
     }
-    else {
-        chance = ((-45 * distance(x, y, WORLD_CENTER_X, WORLD_CENTER_Y) / 200) + 50);
-        if (chance < 5) {
-            chance = 5;
-        }
+    if (x == current_tile_x && y == current_tile_y) {
+        return character_cells[PLAYER];
     }
-    place_building(tile, center, chance);
-    place_building(tile, mart, chance);
-
-    return 0;
+    if (tile_summaries[y][x].flags & TILE_SUMMARY_CENTER) {
+        return terrain_cells[center.id];
+    }
+    if (tile_summaries[y][x].flags & TILE_SUMMARY_MART) {
+        return terrain_cells[mart.id];
+    }
+    return terrain_cells[tile_summaries[y][x].dominant_terrain];
 
 }
 
-int place_building(struct tile *tile, struct terrain terrain, double chance) {
-
-    if (rand() % 100 < chance) {
-        int x;
-        int y;
-        int valid = 1;
-        while (valid == 1) {
-            x = rand() % (TILE_WIDTH_X - 2) + 1;
-            y = rand() % (TILE_LENGTH_Y - 2) + 1;
-            struct point point = tile->tile[y][x];
-            if (!legal_overwrite(point)) {
-                if ((x > 0 && tile->tile[y][x - 1].terrain.id == path.id)
-                    || (x < TILE_WIDTH_X - 1 && tile->tile[y][x + 1].terrain.id == path.id)
-                    || (y > 0 && tile->tile[y - 1][x].terrain.id == path.id)
-                    || (y < TILE_LENGTH_Y - 1 && tile->tile[y + 1][x].terrain.id == path.id)) {
-                    valid = 0;
-                }
+int show_minimap(int center_x, int center_y, const char *message) {
+
+    //a tile is a character, read from the summaries alone, so the window costs the same wherever it is
+    int left_x = center_x - MINIMAP_COLUMNS / 2;
+    int top_y = center_y - MINIMAP_ROWS / 2;
+    long trainers_remaining = 0;
+    screen_cell_t row[MINIMAP_COLUMNS];
+    for (int screen_row = 1; screen_row <= MINIMAP_ROWS; screen_row++) {
+        int y = top_y + screen_row - 1;
+        for (int column = 0; column < MINIMAP_COLUMNS; column++) {
+            int x = left_x + column;
+            row[column] = summary_cell(x, y);
+            if (x >= 0 && x < WORLD_WIDTH_X && y >= 0 && y < WORLD_LENGTH_Y) {
+                trainers_remaining += tile_summaries[y][x].trainers_remaining;
             }
         }
-        tile->tile[y][x].terrain = terrain;
+        screen_put_cells(screen_row, 0, row, MINIMAP_COLUMNS);
     }
+    char line[COMMAND_MAX_SIZE];
+    snprintf(line, sizeof(line), "Around (%d, %d): %d tiles explored, %ld trainers left to battle in view",
+             center_x - WORLD_CENTER_X, center_y - WORLD_CENTER_Y, num_resident_tiles, trainers_remaining);
+    screen_print_line(0, message);
+    screen_print_line(MINIMAP_ROWS + 1, line);
+    screen_refresh();
 
     return 0;
 
 }
 
-int place_player_character(struct tile *tile) {
+int key_direction(int key) {
+
+    //the movement keys of player_turn, as an index into direction_x and direction_y, or -1
+    switch (key) {
+        case '7': case 'y': return 0;
+        case '8': case 'k': case SCREEN_KEY_UP: return 1;
+        case '9': case 'u': return 2;
+        case '4': case 'h': return 3;
+        case '6': case 'l': return 4;
+        case '1': case 'b': return 5;
+        case '2': case 'j': case SCREEN_KEY_DOWN: return 6;
+        case '3': case 'n': return 7;
+        default: return -1;
+    }
 
-    struct heap *turn_heap = tile->turn_heap;
+}
 
-    int x;
-    int y;
-    int found = 0;
-    while (found == 0) {
-        x = rand() % 78 + 1;
-        y = rand() % 19 + 1;
-        if (tile->tile[y][x].terrain.id == path.id) {
-            found = 1;
-        }
-    }
+int print_tile_trainer_distances(struct tile *tile) {
 
-    player_character = malloc(sizeof(struct character));
-    player_character->x = x;
-    player_character->y = y;
-    player_character->type_enum = PLAYER;
-    player_character->type_string = "PLAYER";
-    player_character->printable_character = '@';
-    strcpy(player_character->color, "\033[0;36m");
-    player_character->turn = 0;
-    player_character->direction_set = 0;
-    player_character->in_building = 0;
-    player_character->defeated = 0;
-    heap_insert(turn_heap, player_character);
-    tile->player_character = player_character;
-    tile->tile[y][x].character = player_character;
-    //create distance tiles
     dijkstra(tile, RIVAL);
+    printf("Rival distance tile:\n");
+    print_tile_trainer_distances_printer(tile);
     dijkstra(tile, HIKER);
+    printf("Hiker distance tile:\n");
+    print_tile_trainer_distances_printer(tile);
 
     return 0;
 
 }
 
-int place_trainers(struct tile *tile) {
-
-    int num_trainers_copy = num_trainers;
-    int num_rivals = 0;
-    int num_hikers = 0;
-    int num_random_walkers = 0;
-    int num_pacers = 0;
-    int num_wanderers = 0;
-    int num_stationaries = 0;
-    while (num_trainers_copy > 0) {
-        if (num_rivals == 0) {
-            num_rivals++;
-        }
-        else if (num_hikers == 0) {
-            num_hikers++;
-        }
-        else {
-            int random = rand()%10;
-            if (random >= 0 && random <= 2) {
-                num_rivals++;
-            }
-            else if (random >= 3 && random <= 5) {
-                num_hikers++;
-            }
-            else if (random == 6) {
-                num_random_walkers++;
-            }
-            else if (random == 7) {
-                num_pacers++;
+int print_tile_trainer_distances_printer(struct tile *tile) {
+
+    for (int i = 0; i < TILE_LENGTH_Y; i++) {
+        for (int j = 0; j < TILE_WIDTH_X; j++) {
+            int distance = tile->tile[CELL(j, i)].distance;
+            if (distance == INT_MAX) {
+                printf("  ");
             }
-            else if (random == 8) {
-                num_wanderers++;
+            else if (distance == 0) {
+                printf("\033[31m");
+                printf("00");
+                printf("\033[0m");
             }
-            else if (random == 9) {
-                num_stationaries++;
+            else {
+                printf("%02d", tile->tile[CELL(j, i)].distance % 100);
             }
+            printf(" ");
         }
-        num_trainers_copy--;
+        printf("\n");
     }
 
-    place_trainer_type(tile, num_rivals, RIVAL, 'r');
-    place_trainer_type(tile, num_hikers, HIKER, 'h');
-    place_trainer_type(tile, num_random_walkers, RANDOM_WALKER, 'n');
-    place_trainer_type(tile, num_pacers, PACER, 'p');
-    place_trainer_type(tile, num_wanderers, WANDERER, 'w');
-    place_trainer_type(tile, num_stationaries, STATIONARY, 's');
-
     return 0;
 
 }
 
-int place_trainer_type(struct tile *tile, int num_trainer, enum character_type trainer_type, char character) {
+int print_phase_stats() {
 
-    struct heap *turn_heap = tile->turn_heap;
-    while (num_trainer > 0) {
-        int x;
-        int y;
-        int found = 0;
-        while (found == 0) {
-            x = rand() % 78 + 1;
-            y = rand() % 19 + 1;
-            if (tile->tile[y][x].character == NULL) {
-                if (trainer_type == HIKER) {
-                    //spawns anywhere hiker can reach PC from
-                    if (hiker_distance_tile[y][x] < INT_MAX) {
-                        found = 1;
-                    }
-                }
-                else {
-                    //spawns anywhere rival can reach PC from
-                    if (rival_distance_tile[y][x] < INT_MAX) {
-                        found = 1;
-                    }
-                }
-            }
-        }
-        struct character *trainer = malloc(sizeof(struct character));
-        trainer->x = x;
-        trainer->y = y;
-        trainer->type_enum = trainer_type;
-        //initialize type_string
-        if (trainer->type_enum == RIVAL) {
-            trainer->type_string = "RIVAL";
-        }
-        else if (trainer->type_enum == HIKER) {
-            trainer->type_string = "HIKER";
-        }
-        else if (trainer->type_enum == RANDOM_WALKER) {
-            trainer->type_string = "RANDOM WALKER";
-        }
-        else if (trainer->type_enum == PACER) {
-            trainer->type_string = "PACER";
-        }
-        else if (trainer->type_enum == WANDERER) {
-            trainer->type_string = "WANDERER";
-        }
-        else if (trainer->type_enum == STATIONARY) {
-            trainer->type_string = "STATIONARY";
-        }
-        else {
-            //trainer is not one of the trainer types
-            return 1;
-        }
-        trainer->printable_character = character;
-        strcpy(trainer->color, "\033[31m");
-        trainer->turn = 0;
-        trainer->direction_set = 0;
-        trainer->in_building = 0;
-        trainer->defeated = 0;
-        heap_insert(turn_heap, trainer);
-        tile->tile[y][x].character = trainer;
-        num_trainer--;
+#ifdef PHASE_STATS
+    timer_print_header(stderr);
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        timer_print(stderr, phase_names[phase], &phase_timers[phase]);
+    }
+    char name[COMMAND_MAX_SIZE];
+    for (int type = 0; type < NUM_CHARACTER_TYPES; type++) {
+        snprintf(name, sizeof(name), "behavior %s", character_type_strings[type]);
+        timer_print(stderr, name, &behavior_timers[type]);
     }
+#else
+    fprintf(stderr, "No phase timings: build with -DPHASE_STATS=ON for --stats\n");
+#endif
 
     return 0;
 
 }
 
-int dijkstra(struct tile *tile, enum character_type trainer_type) {
-
-    int start_x = tile->player_character->x;
-    int start_y =tile->player_character->y;
-
-    for (int y = 0; y < TILE_LENGTH_Y; y++) {
-        for (int x = 0; x < TILE_WIDTH_X; x++) {
-            tile->tile[y][x].distance = INT_MAX;
+int print_memory_report(FILE *f) {
+
+    //the world is whatever is resident: every generated tile, the PC and the tables indexing them
+    struct memory_footprint world_footprint;
+    memset(&world_footprint, 0, sizeof(world_footprint));
+    struct tile *smallest_tile = NULL;
+    struct tile *largest_tile = NULL;
+    long smallest_bytes = 0;
+    long largest_bytes = 0;
+    for (int i = 0; i < num_resident_tiles; i++) {
+        struct memory_footprint footprint;
+        memset(&footprint, 0, sizeof(footprint));
+        tile_footprint(resident_tiles[i], &footprint);
+        long bytes = footprint_bytes(&footprint);
+        if (smallest_tile == NULL || bytes < smallest_bytes) {
+            smallest_tile = resident_tiles[i];
+            smallest_bytes = bytes;
         }
-    }
-    tile->tile[start_y][start_x].distance = 0;
-
-    struct heap heap;
-    static struct point *point;
-    heap_init(&heap, comparator_trainer_distance_tile, NULL);
-    for (int y = 0; y < TILE_LENGTH_Y; y++) {
-        for (int x = 0; x < TILE_WIDTH_X; x++) {
-            int weight;
-            if (trainer_type == RIVAL) {
-                weight = tile->tile[y][x].terrain.rival_weight;
-            }
-            else {
-                //character_type type_enum == hiker
-                weight = tile->tile[y][x].terrain.hiker_weight;
-            }
-            if (weight != INT_MAX) {
-                tile->tile[y][x].heap_node = heap_insert(&heap, &tile->tile[y][x]);
-            }
-            else {
-                tile->tile[y][x].heap_node = NULL;
-            }
+        if (largest_tile == NULL || bytes > largest_bytes) {
+            largest_tile = resident_tiles[i];
+            largest_bytes = bytes;
         }
-    }
-    while ((point = heap_remove_min(&heap))) {
-        point->heap_node = NULL;
-        for (int y = -1; y <= 1; y++) {
-            for (int x = -1; x <= 1; x++) {
-                if (point->y + y >= 0 && point->y + y < TILE_LENGTH_Y && point->x + x >= 0 && point->x + x < TILE_WIDTH_X)
-                {
-                    struct point *neighbor = &(tile->tile[point->y + y][point->x + x]);
-                    int candidate_distance;
-                    if (trainer_type == RIVAL) {
-                        candidate_distance = point->distance + neighbor->terrain.rival_weight;
-                    } else {
-                        //character_type type_enum == hiker
-                        candidate_distance = point->distance + neighbor->terrain.hiker_weight;
-                    }
-                    if (neighbor->heap_node != NULL && candidate_distance < neighbor->distance &&
-                        candidate_distance > 0) {
-                        neighbor->distance = candidate_distance;
-                        heap_decrease_key_no_replace(&heap, neighbor->heap_node);
-                    }
-                }
-            }
+        for (int category = 0; category < NUM_MEMORY_CATEGORIES; category++) {
+            world_footprint.objects[category] += footprint.objects[category];
+            world_footprint.bytes[category] += footprint.bytes[category];
         }
     }
-    heap_delete(&heap);
-
-    //updates appropriate trainer distance tile for the data to endure through future dijkstra calls
-    for (int i = 0; i < TILE_LENGTH_Y; i++) {
-        for (int j = 0; j < TILE_WIDTH_X; j++) {
-            if (trainer_type == RIVAL) {
-                rival_distance_tile[i][j] = tile->tile[i][j].distance;
-            }
-            else {
-                //printable_character type_enum = hiker
-                hiker_distance_tile[i][j] = tile->tile[i][j].distance;
-            }
-        }
+    if (player_character != NULL) {
+        world_footprint.objects[MEMORY_CHARACTERS]++;
+        world_footprint.bytes[MEMORY_CHARACTERS] += sizeof(struct character);
     }
-
-    return 0;
-
-}
-
-int legal_overwrite(struct point point) {
-
-    if (point.terrain.id == edge.id
-        || point.terrain.id == path.id
-        || point.terrain.id == center.id
-        || point.terrain.id == mart.id) {
-        return 1;
+    world_footprint.objects[MEMORY_WORLD_TABLES] = WORLD_WIDTH_X * WORLD_LENGTH_Y;
+    world_footprint.bytes[MEMORY_WORLD_TABLES] = sizeof(world) + sizeof(tile_summaries)
+                                                 + 2 * resident_tiles_capacity * sizeof(struct tile *);
+
+    long total_bytes = footprint_bytes(&world_footprint);
+    fprintf(f, "memory: %d tiles, about %ld bytes resident (estimated from allocation sizes)\n", num_resident_tiles,
+            total_bytes);
+    fprintf(f, "%-16s %12s %14s %14s\n", "category", "objects", "bytes", "bytes/tile");
+    for (int category = 0; category < NUM_MEMORY_CATEGORIES; category++) {
+        fprintf(f, "%-16s %12ld %14ld %14ld\n", memory_category_names[category], world_footprint.objects[category],
+                world_footprint.bytes[category],
+                num_resident_tiles > 0 ? world_footprint.bytes[category] / num_resident_tiles : 0);
     }
-    else {
-        return 0;
+    if (num_resident_tiles > 0) {
+        fprintf(f, "per tile: smallest %ld bytes at (%d, %d), largest %ld bytes at (%d, %d)\n", smallest_bytes,
+                smallest_tile->x - WORLD_CENTER_X, smallest_tile->y - WORLD_CENTER_Y, largest_bytes,
+                largest_tile->x - WORLD_CENTER_X, largest_tile->y - WORLD_CENTER_Y);
     }
 
-}
+    return 0;
 
-double distance(int x1, int y1, int x2, int y2) {
-    double square_difference_x = (x2 - x1) * (x2 - x1);
-    double square_difference_y = (y2 - y1) * (y2 - y1);
-    double sum = square_difference_x + square_difference_y;
-    double value = sqrt(sum);
-    return value;
 }
 
-int print_tile_terrain(struct tile *tile) {
-
-    for (int y = 0; y < TILE_LENGTH_Y; y++) {
-        for (int x = 0; x < TILE_WIDTH_X; x++) {
-            char printable_character = tile->tile[y][x].terrain.printable_character;
-            if (tile->tile[y][x].character != NULL) {
-                //set color
-                printable_character = tile->tile[y][x].character->printable_character;
-            }
-            else {
-                //set color
-            }
-            mvaddch(y + 1, x, printable_character);
-        }
-    }
-    addch('\n');
-    refresh();
+void request_memory_report(int signal_number) {
 
-    return 0;
+    //only a flag is safe to touch here; the report is written before the next turn, or as soon as the wait
+    //for a key it interrupted gives up, by answer_memory_report_request
+    (void) signal_number;
+    memory_report_requested = 1;
 
 }
 
-int print_tile_trainer_distances(struct tile *tile) {
+int answer_memory_report_request() {
 
-    dijkstra(tile, RIVAL);
-    printf("Rival distance tile:\n");
-    print_tile_trainer_distances_printer(tile);
-    dijkstra(tile, HIKER);
-    printf("Hiker distance tile:\n");
-    print_tile_trainer_distances_printer(tile);
+    //stderr is the terminal while the screen is drawn on it, so the report is appended to MEMORY_REPORT_FILE
+    //instead and the bottom line of the screen says so
+    memory_report_requested = 0;
+    if (!screen_active()) {
+        return print_memory_report(stderr);
+    }
+    FILE *report = fopen(MEMORY_REPORT_FILE, "a");
+    if (report == NULL) {
+        screen_print_line(SCREEN_HEIGHT - 1, "Could not open " MEMORY_REPORT_FILE " for the memory report");
+    }
+    else {
+        print_memory_report(report);
+        fclose(report);
+        screen_print_line(SCREEN_HEIGHT - 1, "Memory report appended to " MEMORY_REPORT_FILE);
+    }
+    screen_frame();
 
     return 0;
 
 }
 
-int print_tile_trainer_distances_printer(struct tile *tile) {
+int print_heap_stats() {
 
-    for (int i = 0; i < TILE_LENGTH_Y; i++) {
-        for (int j = 0; j < TILE_WIDTH_X; j++) {
-            int distance = tile->tile[i][j].distance;
-            if (distance == INT_MAX) {
-                printf("  ");
+    //turn heaps live as long as their tiles so they are summed over the visited world
+    heap_stats_t turn_heap_stats;
+    memset(&turn_heap_stats, 0, sizeof(turn_heap_stats));
+    int num_tiles = 0;
+    for (int y = 0; y < WORLD_LENGTH_Y; y++) {
+        for (int x = 0; x < WORLD_WIDTH_X; x++) {
+            heap_stats_t heap_stats;
+            if (world[y][x] != NULL && heap_get_stats(world[y][x]->turn_heap, &heap_stats) == 0) {
+                heap_add_stats(&turn_heap_stats, &heap_stats);
+                num_tiles++;
             }
-            else if (distance == 0) {
-                printf("\033[31m");
-                printf("00");
-                printf("\033[0m");
-            }
-            else {
-                printf("%02d", tile->tile[i][j].distance % 100);
-            }
-            printf(" ");
         }
-        printf("\n");
     }
+    fprintf(stderr, "Heap stats over %d tiles:\n", num_tiles);
+    heap_print_stats(stderr, "turn heaps", &turn_heap_stats);
+    heap_print_stats(stderr, "dijkstra heaps", &dijkstra_heap_stats);
 
     return 0;
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include "pool.h"
+
+//Author Maxim Popov
+static void *pool_worker(void *pool_pointer);
+static int pool_work(struct pool *pool);
+
+int pool_init(struct pool *pool, int num_threads) {
+
+    //the thread calling pool_run works too, so it needs one thread fewer than the parallelism asked for
+    pool->num_threads = num_threads > 1 ? num_threads - 1 : 0;
+    pool->threads = malloc(pool->num_threads * sizeof(pthread_t));
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->batch_ready, NULL);
+    pthread_cond_init(&pool->batch_done, NULL);
+    pool->job = NULL;
+    pool->argument = NULL;
+    pool->num_jobs = 0;
+    pool->next_job = 0;
+    pool->jobs_done = 0;
+    pool->active_workers = 0;
+    pool->batch = 0;
+    pool->stopping = 0;
+    for (int i = 0; i < pool->num_threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0) {
+            pool->num_threads = i;
+            pool_destroy(pool);
+            return 1;
+        }
+    }
+
+    return 0;
+
+}
+
+int pool_run(struct pool *pool, int num_jobs, int (*job)(void *argument, int i), void *argument) {
+
+    if (num_jobs == 0) {
+        return 0;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    pool->job = job;
+    pool->argument = argument;
+    pool->num_jobs = num_jobs;
+    pool->next_job = 0;
+    pool->jobs_done = 0;
+    pool->batch++;
+    pthread_cond_broadcast(&pool->batch_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    pool_work(pool);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->jobs_done < pool->num_jobs || pool->active_workers > 0) {
+        pthread_cond_wait(&pool->batch_done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return 0;
+
+}
+
+int pool_destroy(struct pool *pool) {
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->batch_ready);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+    pthread_cond_destroy(&pool->batch_done);
+    pthread_cond_destroy(&pool->batch_ready);
+    pthread_mutex_destroy(&pool->mutex);
+
+    return 0;
+
+}
+
+static void *pool_worker(void *pool_pointer) {
+
+    struct pool *pool = pool_pointer;
+    unsigned long batch = 0;
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        while (!pool->stopping && pool->batch == batch) {
+            pthread_cond_wait(&pool->batch_ready, &pool->mutex);
+        }
+        if (pool->stopping) {
+            break;
+        }
+        batch = pool->batch;
+        pool->active_workers++;
+        pthread_mutex_unlock(&pool->mutex);
+        pool_work(pool);
+        pthread_mutex_lock(&pool->mutex);
+        pool->active_workers--;
+        if (pool->active_workers == 0) {
+            pthread_cond_signal(&pool->batch_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+
+}
+
+static int pool_work(struct pool *pool) {
+
+    //claims jobs until none are left, then reports how many it finished
+    int done = 0;
+    int i;
+    while ((i = __atomic_fetch_add(&pool->next_job, 1, __ATOMIC_RELAXED)) < pool->num_jobs) {
+        pool->job(pool->argument, i);
+        done++;
+    }
+    if (done > 0) {
+        pthread_mutex_lock(&pool->mutex);
+        pool->jobs_done += done;
+        pthread_cond_signal(&pool->batch_done);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    return 0;
+
+}
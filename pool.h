@@ -0,0 +1,33 @@
+#ifndef POKEMON_POOL_H
+#define POKEMON_POOL_H
+
+#include <pthread.h>
+
+//Author Maxim Popov
+//A fixed set of worker threads that run one batch of independent jobs at a time.
+//Threads claim the next unclaimed job from a shared counter, so a slow job never holds up the others.
+
+struct pool {
+    int num_threads;
+    pthread_t *threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t batch_ready;
+    pthread_cond_t batch_done;
+    //current batch: job(argument, i) for every i below num_jobs
+    int (*job)(void *argument, int i);
+    void *argument;
+    int num_jobs;
+    int next_job;
+    int jobs_done;
+    //workers still inside a batch: the next batch waits for them so no worker claims jobs across batches
+    int active_workers;
+    //bumped for every batch so sleeping workers can tell a new batch from a spurious wakeup
+    unsigned long batch;
+    int stopping;
+};
+
+int pool_init(struct pool *pool, int num_threads);
+int pool_run(struct pool *pool, int num_jobs, int (*job)(void *argument, int i), void *argument);
+int pool_destroy(struct pool *pool);
+
+#endif //POKEMON_POOL_H
@@ -0,0 +1,21 @@
+#!/bin/sh
+#Author Maxim Popov
+#Bytes written and time spent per map frame by each screen backend, drawing a seek policy game to a file.
+#usage: render_bench.sh [Pokemon binary] [turns per run] [seed]
+
+pokemon=${1:-./Pokemon}
+turns=${2:-20000}
+seed=${3:-1}
+output=$(mktemp)
+
+printf "%10s %8s %8s %14s %14s\n" trainers screen frames bytes/frame us/frame
+for trainers in 10 100 500; do
+    for screen in ncurses ansi; do
+        #the report line is "screen B: F frames, N bytes, X bytes and Y us per map frame"
+        TERM=${TERM:-xterm} "$pokemon" --screen "$screen" --screen-output "$output" --policy seek \
+            --turns "$turns" --seed "$seed" --numtrainers "$trainers" 2>/dev/null \
+            | awk -v trainers="$trainers" -v screen="$screen" \
+                '/^screen/ { printf "%10d %8s %8d %14d %14.1f\n", trainers, screen, $3, $7, $10 }'
+    done
+done
+rm -f "$output"
@@ -0,0 +1,685 @@
+#ifndef HEADLESS
+#include <ncurses.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "screen.h"
+
+//screen_frame writes to the terminal at most this often while keys are queued up
+#define SCREEN_FRAME_INTERVAL_NS (1000000000L / 60)
+//size the ANSI backend draws at when its output isn't a terminal it can ask
+#define ANSI_DEFAULT_ROWS 24
+#define ANSI_DEFAULT_COLUMNS 80
+#define ANSI_MAX_PAIRS 256
+//unchanged cells between two changed ones that are written again rather than skipped with a cursor move
+#define ANSI_MAX_GAP 4
+//how long a lone escape byte waits for the rest of an arrow key's sequence
+#define ANSI_ESCAPE_DELAY_MS 25
+
+//Author Maxim Popov
+#ifdef HEADLESS
+int screen_headless = 1;
+enum screen_backend screen_backend = SCREEN_BACKEND_ANSI;
+#else
+int screen_headless = 0;
+enum screen_backend screen_backend = SCREEN_BACKEND_NCURSES;
+#endif
+char *screen_output = NULL;
+//lets callers that keep something on screen tell whether it has been wiped since they drew it
+static int clear_count = 0;
+//set when screen_frame held back a frame that is still to be written
+static int frame_pending = 0;
+static struct timespec last_frame_time;
+//frames and bytes written since screen_init, for screen_stats
+static long frames_written = 0;
+static long bytes_written = 0;
+
+//what each backend does for the screen_ function of the same name; the screen_ functions deal with headless runs
+//and the frame presenter, so backends only draw and read keys
+struct backend {
+    int (*init)();
+    int (*end)();
+    //clear and refresh are ncurses macros, hence these two names
+    int (*clear_screen)();
+    int (*print)(const char *string);
+    int (*print_at)(int row, int column, const char *string);
+    int (*print_line)(int row, const char *string);
+    int (*init_color)(int pair, const char *escape);
+    screen_cell_t (*cell)(char character, int pair);
+    int (*put_cells)(int row, int column, const screen_cell_t *cells, int count);
+    int (*refresh_screen)();
+    //returns -1 if wait is 0 and no key is waiting
+    int (*get_key)(int wait);
+};
+static const struct backend *backend = NULL;
+
+static int escape_color(const char *escape) {
+
+    //the foreground of an escape like "\033[0;32m"; black would vanish on most terminals so it becomes the default
+    const char *end = strchr(escape, 'm');
+    if (end == NULL || end - escape < 2) {
+        return SCREEN_COLOR_DEFAULT;
+    }
+    int color = (end[-2] - '0') * 10 + (end[-1] - '0') - 30;
+    if (color <= SCREEN_COLOR_BLACK || color > SCREEN_COLOR_WHITE) {
+        return SCREEN_COLOR_DEFAULT;
+    }
+    return color;
+
+}
+
+#ifndef HEADLESS
+//keys are read through a window nothing is drawn on: getch on stdscr would write out every pending frame
+static WINDOW *input_window = NULL;
+
+//screen_output as ncurses' output; ncurses writes to its descriptor directly, so the bytes are counted
+//from the file offset once it is done
+static FILE *ncurses_output = NULL;
+
+static int ncurses_init() {
+
+    if (screen_output != NULL) {
+        ncurses_output = fopen(screen_output, "w");
+        FILE *input = fopen("/dev/null", "r");
+        const char *terminal = getenv("TERM") != NULL ? getenv("TERM") : "xterm";
+        if (ncurses_output == NULL || input == NULL || newterm(terminal, ncurses_output, input) == NULL) {
+            return 1;
+        }
+    }
+    else if (initscr() == NULL) {
+        return 1;
+    }
+    raw();
+    noecho();
+    curs_set(0);
+    input_window = newwin(1, 1, LINES - 1, COLS - 1);
+    keypad(input_window, TRUE);
+    if (has_colors()) {
+        start_color();
+        use_default_colors();
+    }
+
+    return 0;
+
+}
+
+static int ncurses_end() {
+
+    endwin();
+    if (ncurses_output != NULL) {
+        fflush(ncurses_output);
+        bytes_written = lseek(fileno(ncurses_output), 0, SEEK_CUR);
+    }
+
+    return 0;
+
+}
+
+static int ncurses_clear() {
+
+    clear();
+
+    return 0;
+
+}
+
+static int ncurses_print(const char *string) {
+
+    addstr(string);
+
+    return 0;
+
+}
+
+static int ncurses_print_at(int row, int column, const char *string) {
+
+    mvaddstr(row, column, string);
+
+    return 0;
+
+}
+
+static int ncurses_print_line(int row, const char *string) {
+
+    move(row, 0);
+    clrtoeol();
+    addstr(string);
+
+    return 0;
+
+}
+
+static int ncurses_init_color(int pair, const char *escape) {
+
+    if (has_colors()) {
+        init_pair(pair, escape_color(escape), -1);
+    }
+
+    return 0;
+
+}
+
+static screen_cell_t ncurses_cell(char character, int pair) {
+
+    if (has_colors()) {
+        return (unsigned char) character | COLOR_PAIR(pair);
+    }
+    return (unsigned char) character;
+
+}
+
+static int ncurses_put_cells(int row, int column, const screen_cell_t *cells, int count) {
+
+    if (sizeof(chtype) == sizeof(screen_cell_t)) {
+        mvaddchnstr(row, column, (const chtype *) cells, count);
+    }
+    else {
+        chtype line[count];
+        for (int i = 0; i < count; i++) {
+            line[i] = cells[i];
+        }
+        mvaddchnstr(row, column, line, count);
+    }
+
+    return 0;
+
+}
+
+static int ncurses_refresh() {
+
+    refresh();
+
+    return 0;
+
+}
+
+static int ncurses_get_key(int wait) {
+
+    nodelay(input_window, !wait);
+    int key = wgetch(input_window);
+    return key == ERR ? -1 : key;
+
+}
+
+static const struct backend ncurses_backend = {
+        ncurses_init, ncurses_end, ncurses_clear, ncurses_print, ncurses_print_at, ncurses_print_line,
+        ncurses_init_color, ncurses_cell, ncurses_put_cells, ncurses_refresh, ncurses_get_key
+};
+#endif
+
+//the ANSI backend keeps the frame being drawn and the frame on the terminal as cells, and on refresh writes
+//the cells that differ with a single write(); a cell is its character with its color pair in bits 8 to 15
+static int ansi_fd = -1;
+static int ansi_rows;
+static int ansi_columns;
+static screen_cell_t *ansi_cells = NULL;
+static screen_cell_t *ansi_shown = NULL;
+static int ansi_cursor_row = 0;
+static int ansi_cursor_column = 0;
+//escape sequence selecting each color pair, as given to screen_init_color
+static const char *ansi_colors[ANSI_MAX_PAIRS];
+//room for every cell with a cursor move and a color change in front of it
+static char *ansi_buffer = NULL;
+static struct termios ansi_saved_termios;
+static int ansi_termios_saved = 0;
+//bytes read after an escape byte that turned out not to be an arrow key, handed out before reading more
+static int ansi_pending_keys[2];
+static int ansi_num_pending_keys = 0;
+
+static int ansi_write(const char *bytes, size_t size) {
+
+    while (size > 0) {
+        ssize_t written = write(ansi_fd, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return 1;
+        }
+        bytes_written += written;
+        bytes += written;
+        size -= written;
+    }
+
+    return 0;
+
+}
+
+static int ansi_init() {
+
+    ansi_fd = screen_output != NULL ? open(screen_output, O_WRONLY | O_CREAT | O_TRUNC, 0644) : STDOUT_FILENO;
+    if (ansi_fd == -1) {
+        return 1;
+    }
+    struct winsize size;
+    if (ioctl(ansi_fd, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        ansi_rows = size.ws_row;
+        ansi_columns = size.ws_col;
+    }
+    else {
+        ansi_rows = ANSI_DEFAULT_ROWS;
+        ansi_columns = ANSI_DEFAULT_COLUMNS;
+    }
+    ansi_cells = malloc(ansi_rows * ansi_columns * sizeof(screen_cell_t));
+    ansi_shown = malloc(ansi_rows * ansi_columns * sizeof(screen_cell_t));
+    ansi_buffer = malloc(ansi_rows * ansi_columns * 32 + 64);
+    for (int i = 0; i < ansi_rows * ansi_columns; i++) {
+        ansi_cells[i] = ' ';
+        ansi_shown[i] = ' ';
+    }
+    for (int pair = 0; pair < ANSI_MAX_PAIRS; pair++) {
+        ansi_colors[pair] = "\033[0m";
+    }
+    if (screen_output == NULL && tcgetattr(STDIN_FILENO, &ansi_saved_termios) == 0) {
+        struct termios raw_termios = ansi_saved_termios;
+        cfmakeraw(&raw_termios);
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw_termios);
+        ansi_termios_saved = 1;
+    }
+    //alternate screen, cleared, cursor hidden: what the shown cells say is on the terminal
+    const char *start = "\033[?1049h\033[0m\033[H\033[2J\033[?25l";
+    return ansi_write(start, strlen(start));
+
+}
+
+static int ansi_end() {
+
+    const char *end = "\033[0m\033[?25h\033[?1049l";
+    ansi_write(end, strlen(end));
+    if (ansi_termios_saved) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &ansi_saved_termios);
+    }
+    if (screen_output != NULL) {
+        close(ansi_fd);
+    }
+
+    return 0;
+
+}
+
+static int ansi_clear() {
+
+    for (int i = 0; i < ansi_rows * ansi_columns; i++) {
+        ansi_cells[i] = ' ';
+    }
+    ansi_cursor_row = 0;
+    ansi_cursor_column = 0;
+
+    return 0;
+
+}
+
+static int ansi_print(const char *string) {
+
+    //like addstr: a newline blanks the rest of the row, text wraps at the last column and stops at the last row
+    for (; *string != '\0' && ansi_cursor_row < ansi_rows; string++) {
+        if (*string == '\n') {
+            for (int column = ansi_cursor_column; column < ansi_columns; column++) {
+                ansi_cells[ansi_cursor_row * ansi_columns + column] = ' ';
+            }
+            ansi_cursor_row++;
+            ansi_cursor_column = 0;
+            continue;
+        }
+        ansi_cells[ansi_cursor_row * ansi_columns + ansi_cursor_column] = (unsigned char) *string;
+        if (++ansi_cursor_column == ansi_columns) {
+            ansi_cursor_row++;
+            ansi_cursor_column = 0;
+        }
+    }
+
+    return 0;
+
+}
+
+static int ansi_print_at(int row, int column, const char *string) {
+
+    if (row < 0 || row >= ansi_rows || column < 0 || column >= ansi_columns) {
+        return 1;
+    }
+    ansi_cursor_row = row;
+    ansi_cursor_column = column;
+    return ansi_print(string);
+
+}
+
+static int ansi_print_line(int row, const char *string) {
+
+    if (row < 0 || row >= ansi_rows) {
+        return 1;
+    }
+    for (int column = 0; column < ansi_columns; column++) {
+        ansi_cells[row * ansi_columns + column] = ' ';
+    }
+    return ansi_print_at(row, 0, string);
+
+}
+
+static int ansi_init_color(int pair, const char *escape) {
+
+    //the escape is written as it is, except black which becomes the default as it does with ncurses
+    if (pair > 0 && pair < ANSI_MAX_PAIRS) {
+        ansi_colors[pair] = escape_color(escape) == SCREEN_COLOR_DEFAULT ? "\033[0m" : escape;
+    }
+
+    return 0;
+
+}
+
+static screen_cell_t ansi_cell(char character, int pair) {
+
+    return (unsigned char) character | (screen_cell_t) (pair & (ANSI_MAX_PAIRS - 1)) << 8;
+
+}
+
+static int ansi_put_cells(int row, int column, const screen_cell_t *cells, int count) {
+
+    //like mvaddchnstr: clipped to the row, cursor left alone
+    if (row < 0 || row >= ansi_rows || column < 0) {
+        return 1;
+    }
+    if (count > ansi_columns - column) {
+        count = ansi_columns - column;
+    }
+    memcpy(&ansi_cells[row * ansi_columns + column], cells, count * sizeof(screen_cell_t));
+
+    return 0;
+
+}
+
+static char *ansi_put_cell(char *output, screen_cell_t cell, int *output_pair) {
+
+    int pair = (cell >> 8) & (ANSI_MAX_PAIRS - 1);
+    if (pair != *output_pair) {
+        size_t length = strlen(ansi_colors[pair]);
+        memcpy(output, ansi_colors[pair], length);
+        output += length;
+        *output_pair = pair;
+    }
+    *output++ = (char) (cell & 0xff);
+    return output;
+
+}
+
+static int ansi_refresh() {
+
+    //the terminal's cursor and color are tracked so a run of changed cells costs one move and only the color
+    //changes inside it; a gap of a few unchanged cells is cheaper to write again than to move over
+    char *output = ansi_buffer;
+    int output_row = -1;
+    int output_column = -1;
+    int output_pair = -1;
+    for (int row = 0; row < ansi_rows; row++) {
+        for (int column = 0; column < ansi_columns; column++) {
+            int i = row * ansi_columns + column;
+            if (ansi_cells[i] == ansi_shown[i]) {
+                continue;
+            }
+            if (row == output_row && column > output_column && column - output_column <= ANSI_MAX_GAP) {
+                for (int gap = row * ansi_columns + output_column; gap < i; gap++) {
+                    output = ansi_put_cell(output, ansi_cells[gap], &output_pair);
+                }
+            }
+            else if (row != output_row || column != output_column) {
+                output += sprintf(output, "\033[%d;%dH", row + 1, column + 1);
+            }
+            output = ansi_put_cell(output, ansi_cells[i], &output_pair);
+            ansi_shown[i] = ansi_cells[i];
+            output_row = row;
+            output_column = column + 1;
+        }
+    }
+    if (output == ansi_buffer) {
+        return 0;
+    }
+    return ansi_write(ansi_buffer, output - ansi_buffer);
+
+}
+
+static int ansi_read_byte(int timeout) {
+
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    unsigned char byte;
+    if (poll(&input, 1, timeout) <= 0 || read(STDIN_FILENO, &byte, 1) != 1) {
+        return -1;
+    }
+    return byte;
+
+}
+
+static int ansi_get_key(int wait) {
+
+    if (screen_output != NULL) {
+        return SCREEN_KEY_ESCAPE;
+    }
+    if (ansi_num_pending_keys > 0) {
+        int key = ansi_pending_keys[0];
+        ansi_pending_keys[0] = ansi_pending_keys[1];
+        ansi_num_pending_keys--;
+        return key;
+    }
+    int key = ansi_read_byte(wait ? -1 : 0);
+    if (key != SCREEN_KEY_ESCAPE) {
+        return key;
+    }
+    //arrow keys arrive as escape [ A or escape O A, in normal and application cursor mode
+    int introducer = ansi_read_byte(ANSI_ESCAPE_DELAY_MS);
+    if (introducer != '[' && introducer != 'O') {
+        if (introducer != -1) {
+            ansi_pending_keys[ansi_num_pending_keys++] = introducer;
+        }
+        return SCREEN_KEY_ESCAPE;
+    }
+    int final = ansi_read_byte(ANSI_ESCAPE_DELAY_MS);
+    if (final == 'A') {
+        return SCREEN_KEY_UP;
+    }
+    if (final == 'B') {
+        return SCREEN_KEY_DOWN;
+    }
+    ansi_pending_keys[ansi_num_pending_keys++] = introducer;
+    if (final != -1) {
+        ansi_pending_keys[ansi_num_pending_keys++] = final;
+    }
+    return SCREEN_KEY_ESCAPE;
+
+}
+
+static const struct backend ansi_backend = {
+        ansi_init, ansi_end, ansi_clear, ansi_print, ansi_print_at, ansi_print_line,
+        ansi_init_color, ansi_cell, ansi_put_cells, ansi_refresh, ansi_get_key
+};
+
+int screen_init() {
+
+    if (screen_headless) {
+        return 0;
+    }
+    if (screen_backend == SCREEN_BACKEND_ANSI) {
+        backend = &ansi_backend;
+    }
+#ifndef HEADLESS
+    else {
+        backend = &ncurses_backend;
+    }
+#endif
+    if (backend == NULL || backend->init() != 0) {
+        //nothing drawn from here on, so the caller can still report the failure on a usable terminal
+        screen_headless = 1;
+        return 1;
+    }
+
+    return 0;
+
+}
+
+int screen_end() {
+
+    if (!screen_headless) {
+        backend->end();
+    }
+
+    return 0;
+
+}
+
+int screen_active() {
+
+    return !screen_headless;
+
+}
+
+int screen_interactive() {
+
+    //a screen drawn to screen_output has nobody in front of it to press keys
+    return !screen_headless && screen_output == NULL;
+
+}
+
+int screen_clear() {
+
+    clear_count++;
+    if (!screen_headless) {
+        backend->clear_screen();
+    }
+
+    return 0;
+
+}
+
+int screen_clear_count() {
+
+    return clear_count;
+
+}
+
+int screen_print(const char *string) {
+
+    if (!screen_headless) {
+        backend->print(string);
+    }
+
+    return 0;
+
+}
+
+int screen_print_at(int row, int column, const char *string) {
+
+    if (!screen_headless) {
+        backend->print_at(row, column, string);
+    }
+
+    return 0;
+
+}
+
+int screen_print_line(int row, const char *string) {
+
+    //replaces the whole row, leaving the rest of the screen alone
+    if (!screen_headless) {
+        backend->print_line(row, string);
+    }
+
+    return 0;
+
+}
+
+int screen_init_color(int pair, const char *escape) {
+
+    if (!screen_headless) {
+        backend->init_color(pair, escape);
+    }
+
+    return 0;
+
+}
+
+screen_cell_t screen_cell(char character, int pair) {
+
+    //callers work these out once and keep them, so drawing a cell is a plain copy
+    if (!screen_headless) {
+        return backend->cell(character, pair);
+    }
+
+    return (unsigned char) character;
+
+}
+
+int screen_put_cells(int row, int column, const screen_cell_t *cells, int count) {
+
+    if (!screen_headless) {
+        backend->put_cells(row, column, cells, count);
+    }
+
+    return 0;
+
+}
+
+int screen_refresh() {
+
+    if (!screen_headless) {
+        backend->refresh_screen();
+        frames_written++;
+        frame_pending = 0;
+        clock_gettime(CLOCK_MONOTONIC, &last_frame_time);
+    }
+
+    return 0;
+
+}
+
+int screen_frame() {
+
+    //like screen_refresh, but a frame that comes soon after the last one while the player is typing ahead
+    //is held back, so the game never waits on the terminal for states nobody would see
+    //screen_get_key writes it out before it waits for a key; without a player every frame is written
+    if (!screen_headless) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed = (now.tv_sec - last_frame_time.tv_sec) * 1000000000L + (now.tv_nsec - last_frame_time.tv_nsec);
+        frame_pending = 1;
+        if (elapsed >= SCREEN_FRAME_INTERVAL_NS || !screen_interactive()) {
+            screen_refresh();
+        }
+    }
+
+    return 0;
+
+}
+
+int screen_get_key() {
+
+    if (!screen_headless) {
+        if (frame_pending) {
+            //a key already waiting means another frame is on its way; otherwise show the last one before blocking
+            int key = backend->get_key(0);
+            if (key != -1) {
+                return key;
+            }
+            screen_refresh();
+        }
+        return backend->get_key(1);
+    }
+
+    //nothing to read from: callers running headless get their keys elsewhere
+    return SCREEN_KEY_ESCAPE;
+
+}
+
+int screen_stats(long *frames, long *bytes) {
+
+    //with ncurses, bytes are only counted for a screen_output that is a regular file, once the screen has ended
+    *frames = frames_written;
+    *bytes = bytes_written;
+
+    return 0;
+
+}
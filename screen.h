@@ -0,0 +1,50 @@
+#ifndef POKEMON_SCREEN_H
+#define POKEMON_SCREEN_H
+
+//Author Maxim Popov
+//All terminal drawing and key input goes through these functions so the game can run without a terminal.
+//When screen_headless is set they do nothing; building with HEADLESS leaves ncurses out entirely,
+//so only the ANSI backend is left to draw with.
+
+//same values as ncurses' KEY_DOWN and KEY_UP
+#define SCREEN_KEY_DOWN 0402
+#define SCREEN_KEY_UP 0403
+#define SCREEN_KEY_ESCAPE 27
+
+//same values as ncurses' COLOR_ constants; SCREEN_COLOR_DEFAULT is the terminal's own foreground
+#define SCREEN_COLOR_DEFAULT -1
+#define SCREEN_COLOR_BLACK 0
+#define SCREEN_COLOR_WHITE 7
+
+//a character with its color pair combined the way the backend wants it; for ncurses that is a chtype
+typedef unsigned int screen_cell_t;
+
+//ncurses, or frames composed in a buffer and written as raw ANSI escapes
+enum screen_backend {
+    SCREEN_BACKEND_NCURSES,
+    SCREEN_BACKEND_ANSI
+};
+
+extern int screen_headless;
+extern enum screen_backend screen_backend;
+//when set, frames are written to this file instead of the terminal and no keys can be read
+extern char *screen_output;
+
+int screen_init();
+int screen_end();
+int screen_active();
+int screen_interactive();
+int screen_clear();
+int screen_clear_count();
+int screen_print(const char *string);
+int screen_print_at(int row, int column, const char *string);
+int screen_print_line(int row, const char *string);
+int screen_init_color(int pair, const char *escape);
+screen_cell_t screen_cell(char character, int pair);
+int screen_put_cells(int row, int column, const screen_cell_t *cells, int count);
+int screen_refresh();
+int screen_frame();
+int screen_get_key();
+int screen_stats(long *frames, long *bytes);
+
+#endif //POKEMON_SCREEN_H
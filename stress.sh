@@ -0,0 +1,15 @@
+#!/bin/sh
+#Author Maxim Popov
+#Turns per second of a headless game against the number of trainers per tile.
+#usage: stress.sh [Pokemon binary] [turns per run] [seed]
+
+pokemon=${1:-./Pokemon}
+turns=${2:-200000}
+seed=${3:-1}
+
+printf "%10s %12s %12s\n" trainers turns turns/s
+for trainers in 10 50 100 250 500 1000 1500 2000; do
+    #the summary line is "seed S: T turns (P by the PC) on N tiles in X s, R turns/s"
+    "$pokemon" --headless --turns "$turns" --seed "$seed" --numtrainers "$trainers" \
+        | awk -v trainers="$trainers" '/^seed/ { printf "%10d %12d %12d\n", trainers, $3, $(NF - 1) }'
+done
@@ -0,0 +1,94 @@
+#include <time.h>
+#include "timer.h"
+
+//Author Maxim Popov
+static int timer_bucket(uint64_t nanoseconds);
+static uint64_t timer_bucket_middle(int bucket);
+
+uint64_t timer_now() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+}
+
+int timer_record(struct timer_histogram *histogram, uint64_t nanoseconds) {
+
+    //world simulation threads time trainer behaviors concurrently, so every field is updated atomically
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->total, nanoseconds, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->buckets[timer_bucket(nanoseconds)], 1, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    while (nanoseconds > max
+           && !__atomic_compare_exchange_n(&histogram->max, &max, nanoseconds, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+
+    return 0;
+
+}
+
+uint64_t timer_percentile(const struct timer_histogram *histogram, double fraction) {
+
+    //the middle of the bucket holding the sample that fraction of all samples are at or below
+    uint64_t rank = (uint64_t) (fraction * histogram->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < TIMER_BUCKETS; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen >= rank) {
+            uint64_t middle = timer_bucket_middle(bucket);
+            return middle < histogram->max ? middle : histogram->max;
+        }
+    }
+    return 0;
+
+}
+
+int timer_print_header(FILE *f) {
+
+    fprintf(f, "%-28s %10s %12s %10s %10s %10s %10s\n", "phase", "calls", "total ms", "mean us", "p50 us", "p99 us",
+            "max us");
+
+    return 0;
+
+}
+
+int timer_print(FILE *f, const char *name, const struct timer_histogram *histogram) {
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+    fprintf(f, "%-28s %10llu %12.3f %10.3f %10.3f %10.3f %10.3f\n", name, (unsigned long long) histogram->count,
+            histogram->total / 1e6, (double) histogram->total / histogram->count / 1e3,
+            timer_percentile(histogram, 0.5) / 1e3, timer_percentile(histogram, 0.99) / 1e3, histogram->max / 1e3);
+
+    return 0;
+
+}
+
+static int timer_bucket(uint64_t nanoseconds) {
+
+    //values below TIMER_SUB_BUCKETS get a bucket each; above, the top TIMER_SUB_BUCKET_BITS after the leading one
+    //pick one of the TIMER_SUB_BUCKETS buckets of its power of two
+    if (nanoseconds < TIMER_SUB_BUCKETS) {
+        return (int) nanoseconds;
+    }
+    int exponent = 63 - __builtin_clzll(nanoseconds);
+    int sub_bucket = (int) (nanoseconds >> (exponent - TIMER_SUB_BUCKET_BITS)) & (TIMER_SUB_BUCKETS - 1);
+    return (exponent - TIMER_SUB_BUCKET_BITS + 1) * TIMER_SUB_BUCKETS + sub_bucket;
+
+}
+
+static uint64_t timer_bucket_middle(int bucket) {
+
+    if (bucket < TIMER_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / TIMER_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t) (TIMER_SUB_BUCKETS + bucket % TIMER_SUB_BUCKETS) << shift;
+    return low + ((1ULL << shift) >> 1);
+
+}
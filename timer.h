@@ -0,0 +1,38 @@
+#ifndef POKEMON_TIMER_H
+#define POKEMON_TIMER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+//Author Maxim Popov
+//Monotonic clock timers for hot paths, collected into log scale histograms of nanoseconds.
+//TIMER_START and TIMER_STOP only time anything in PHASE_STATS builds and are empty statements otherwise.
+
+//every power of two is split into TIMER_SUB_BUCKETS buckets, so a percentile is off by at most 1/TIMER_SUB_BUCKETS
+#define TIMER_SUB_BUCKET_BITS 3
+#define TIMER_SUB_BUCKETS (1 << TIMER_SUB_BUCKET_BITS)
+#define TIMER_BUCKETS (64 * TIMER_SUB_BUCKETS)
+
+struct timer_histogram {
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+    uint64_t buckets[TIMER_BUCKETS];
+};
+
+#ifdef PHASE_STATS
+# define TIMER_START(start) uint64_t start = timer_now()
+# define TIMER_STOP(start, histogram) timer_record((histogram), timer_now() - (start))
+#else
+# define TIMER_START(start) ((void) 0)
+# define TIMER_STOP(start, histogram) ((void) 0)
+#endif
+
+uint64_t timer_now();
+//safe to call from several threads at once on the same histogram
+int timer_record(struct timer_histogram *histogram, uint64_t nanoseconds);
+uint64_t timer_percentile(const struct timer_histogram *histogram, double fraction);
+int timer_print_header(FILE *f);
+int timer_print(FILE *f, const char *name, const struct timer_histogram *histogram);
+
+#endif //POKEMON_TIMER_H